@@ -6,5 +6,7 @@
 #define ECAS_EXAMPLES_DEMO_HPP_
 
 void GraphBaseDemo();
+// The timing of memcpy and gemm on misaligned, aligned and huge-page memory.
+void MemoryBenchDemo();
 
 #endif //ECAS_CORE_ASYNC_GRAPH_HPP_
\ No newline at end of file
@@ -44,15 +44,15 @@ void TaskA(void *usr, std::vector<ecas::ITensor *> &inputs, std::vector<ecas::IT
     AlgoTasks *ins = (AlgoTasks *)usr;
     static int count = 0;
     // TODO: 检查维度（用static 检查一次即可），宏定义，归到工具中
-    float *data = (float *)inputs[0]->GetData(); // 600, 600
+    float *in_data = (float *)inputs[0]->GetData(); // 600, 600
     int rows = inputs[0]->shape()[0];
     int cols = inputs[0]->shape()[1];
 
+    // 转置到临时内存中，不修改输入，运行结束后自动回收。
+    float *data = (float *)ecas::TaskContext::ScratchAlloc(rows * cols * sizeof(float));
     for (int i=0; i<rows; i++) {
-        for (int j=i+1; j<cols; j++) {
-            float temp = data[i*cols + j];
-            data[i*cols + j] = data[j*cols + i];
-            data[j*cols + i] = temp;
+        for (int j=0; j<cols; j++) {
+            data[j*rows + i] = in_data[i*cols + j];
         }
     }
 
@@ -195,7 +195,6 @@ void GraphBaseDemo() {
     session->CreateNode("n2", TaskB, {{ecas::FP32, 200, 600}}, {{ecas::FP32, 200, 300}}, 1);
     session->CreateNode("n3", TaskC, {{ecas::FP32, 400, 600}}, {{ecas::FP32, 400, 300}}, 0);
     session->CreateNode("n4", TaskD, {{ecas::FP32, 200, 300}, {ecas::FP32, 400, 300}}, {{ecas::FP32, 1}}, 0);
-    session->CreateNode("n5", {{"n1", "n2"}, {"n2", "n3"}});
     
     session->BuildGraph({{"n1", "n2"}, {"n1", "n3"}, {"n2", "n4"}, {"n3", "n4"}});
     session->ShowInfo();
@@ -6,5 +6,6 @@ int main() {
     ecas::HelloWorld();
 
     GraphBaseDemo();
+    MemoryBenchDemo();
     return 0;
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #ifndef ECAS_CXX_API_HPP_
 #define ECAS_CXX_API_HPP_
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <functional>
+#include <future>
 
 namespace ecas {
 
@@ -15,7 +17,7 @@ namespace ecas {
 
 enum ExecutionMode {
     SINGLE = 0,   // Independent single task
-    SERIAL = 1,   // Serial multitasking
+    SERIAL = 1,   // Serial multitasking, the graph runs in topological order on the caller's thread
     GRAPH         // Multitasking with Computational Graphs
 };
 
@@ -32,9 +34,63 @@ enum MemoryMode {
     ON_DEVICE, 
 };
 
+enum SchedulePolicy {
+    GROUP_THREAD = 0,  // One thread per group, nodes of a group run in a fixed order.
+    WORK_STEALING = 1  // num_thread workers with work stealing, group id is only an affinity hint.
+};
+
+// What the producer of an edge does when all the slots are full, set in BuildGraph
+// by the relation like {"input[overflow=latest]", "n1", "n2[overflow=drop_oldest]"}.
+enum OverflowPolicy {
+    OVERFLOW_BLOCK = 0, // "block": wait for a free slot.
+    DROP_OLDEST = 1,    // "drop_oldest": take back the oldest frame not consumed yet.
+    DROP_NEWEST = 2,    // "drop_newest": drop the new frame.
+    KEEP_LATEST = 3     // "latest": keep only the newest frame for the consumer.
+};
+
+// Core binding and priority of the thread of a group, applied when the threads spawn.
+// In WORK_STEALING mode, it is applied to the worker which is the home of the group.
+struct GroupAttr {
+    int group_id = 0;
+    std::vector<int> cpus;  // Cores to bind, empty means no binding.
+    int priority = 0;       // > 0: use SCHED_FIFO with this priority (1-99).
+    int nice = 0;           // Used when priority is 0, -20 (highest) to 19.
+};
+
 struct SessionConfig {
     ExecutionMode mode;
-    int num_thread;
+    int num_thread;  // Number of workers for WORK_STEALING, <= 0 means hardware concurrency.
+    SchedulePolicy policy = GROUP_THREAD;
+    std::vector<GroupAttr> group_attrs;
+    // Not empty: profile the graph from Start to Stop, and write a Chrome trace json
+    // here at Stop, which can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+    std::string profile_path;
+    // GROUP_THREAD only: fuse the linear chains of the nodes in the same group (one output
+    // feeding one input, no edge attributes, no replicas) into composite nodes in BuildGraph,
+    // so that a chain has no queue inside and is borrowed once per frame. Named like "n2+n3"
+    // after fusion. A fused graph can not be calibrated, see GraphCalibrate.
+    bool fuse_chains = false;
+    // The data of the tensors created by the session, including the queue slots, starts at
+    // a multiple of memory_alignment (a power of 2).
+    uint32_t memory_alignment = 64;
+    // The buffers of 2 MB or more use huge pages to reduce the TLB misses, from the reserved
+    // pool (/proc/sys/vm/nr_hugepages) if possible, otherwise transparent huge pages. Linux only.
+    bool huge_pages = false;
+};
+
+// The buffers of the tensors are pooled by size classes, see Session::GetMemoryStats.
+struct MemoryStats {
+    uint64_t hits = 0;         // Allocations served by the cached buffers.
+    uint64_t misses = 0;       // Allocations from the system.
+    uint64_t bytes_cached = 0; // Released buffers kept for reuse.
+    uint64_t bytes_in_use = 0;
+};
+
+// How the pages of a file mapped tensor are loaded, see Session::CreateMappedITensor.
+enum MapPrefetch {
+    PREFETCH_NONE = 0,     // Loaded by page faults on first access.
+    PREFETCH_ASYNC = 1,    // madvise(MADV_WILLNEED), read ahead in the background.
+    PREFETCH_POPULATE = 2  // MAP_POPULATE, loaded before the call returns.
 };
 
 union Param {
@@ -47,8 +103,27 @@ class ECAS_API ITensor {
 public:
     inline int id() const { return id_; }
     inline std::vector<int> &shape() { return shape_; }
+    // In elements, of the memory that GetData points to. A view may have any strides, see
+    // Session::CreateViewITensor, the others are contiguous.
+    inline std::vector<int> &strides() { return strides_; }
+    bool is_contiguous() const {
+        int stride = 1;
+        for (int i = (int)shape_.size() - 1; i >= 0; i--) {
+            if (shape_[i] != 1 && strides_[i] != stride)
+                return false;
+            stride *= shape_[i];
+        }
+        return true;
+    }
     inline MemoryMode mode() const { return mode_; }    
     inline void SetId(int id) { id_ = id; }
+    // The stream that the frame belongs to, -1 for none. Passed along with the id.
+    inline int stream_id() const { return stream_id_; }
+    inline void SetStreamId(int stream_id) { stream_id_ = stream_id; }
+    // Frames with priority > 0 are urgent: they go ahead of the normal frames in each queue,
+    // and the nodes holding them are scheduled first. Passed along with the id.
+    inline int priority() const { return priority_; }
+    inline void SetPriority(int priority) { priority_ = priority; }
 
     virtual void BindHostDataPtr(void *data) = 0;
     virtual void *GetData(MemoryMode mode = ON_HOST) = 0;
@@ -58,12 +133,29 @@ protected:
     ITensor() {}
 
     int id_;
+    int stream_id_;
+    int priority_;
     std::vector<int> shape_; // n c h w
+    std::vector<int> strides_;
 
     MemoryMode mode_;
     DataType type_;
 };
 
+// Information of the frame being processed, only valid inside a Task.
+class ECAS_API TaskContext {
+public:
+    // The stream id of the frame, -1 for none.
+    static int StreamId();
+    // The state of the running node for the stream of the frame, see Session::DeclareNodeState.
+    // nullptr if the node has no state.
+    static void *State();
+    // Temporary memory of the worker thread, 64-byte aligned and not initialized. It is
+    // given back when the node run ends, so do not keep it across runs. The operators
+    // called in a Task can use it too. nullptr outside a Task.
+    static void *ScratchAlloc(uint32_t size);
+};
+
 // Session
 using Task = std::function<void(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs)>;
 class ECAS_API Session {
@@ -74,6 +166,24 @@ public:
     ///////////
     // Memory
     ITensor *CreateITensor(std::vector<int> &&shape, DataType type, void *data = nullptr);
+    // The buffer goes back to the pool of the session, and is handed out again by the next
+    // CreateITensor or graph of a similar size. The tensor can not be used after it.
+    void ReleaseITensor(ITensor *tensor);
+    // A read-only tensor on the file content from offset, mapped instead of read into the heap,
+    // so the sessions and processes mapping the same file share one copy in the page cache.
+    // Writing to its data crashes. It can be released by ReleaseITensor.
+    ITensor *CreateMappedITensor(const std::string &path, uint64_t offset, std::vector<int> &&shape,
+                                 DataType type, MapPrefetch prefetch = PREFETCH_NONE);
+    // A tensor on the memory of parent without copying, the parent should outlive it.
+    // offset and strides are in elements of the parent's memory, the strides are left empty
+    // to be contiguous, which reshapes a contiguous parent.
+    ITensor *CreateViewITensor(ITensor *parent, std::vector<int> &&shape, std::vector<int> &&strides = {},
+                               uint32_t offset = 0);
+    // The view of [start, end) along axis, e.g. the channels of NCHW with axis 1.
+    ITensor *SliceITensor(ITensor *parent, int axis, int start, int end);
+    MemoryStats GetMemoryStats();
+    // Free the cached buffers until at most max_bytes are left.
+    void TrimMemory(uint64_t max_bytes = 0);
     
     /////////////////////
     // Operator executor   TODO: inplace.
@@ -84,21 +194,96 @@ public:
    
     //////////////
     // AsyncGraph
+    // num_replica > 1: the task can run on several frames at the same time with WORK_STEALING,
+    // it must be reentrant. The outputs keep the order of the inputs.
     void CreateNode(const std::string &name, Task &&task, 
                     std::vector<std::vector<int>> &&input_dims, 
                     std::vector<std::vector<int>> &&output_dims, 
+                    int group_id = 0, int num_replica = 1);
+    // Composite node: the nodes created above and named in relation run one after another
+    // on one thread, and the tensors between them are taken from an internal arena instead
+    // of the queues. The inner nodes are replaced by this node in the graph, and the open
+    // ports of the subgraph become its ports, ordered by the execution order.
+    void CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation,
                     int group_id = 0);
-    void CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation);
+    // Edge attributes follow the rear node, like "n2[depth=4,overflow=drop_oldest]".
+    // A cycle needs a delay edge, like {"n1", "n2", "n3"}, {"n2", "n2[delay=0]"}: the output
+    // of frame t is fed back to frame t+1, starting from one frame filled with the value.
+    // The ports of a node follow the order of its nodes in relation, and the graph input /
+    // output takes the port after them.
+    // The open ports left by relation are the graph ports, each one has its own queue.
+    // Name them by "input:NAME" / "output:NAME", like {"input:video", "v1", "fuse", "output:box"},
+    // {"input:audio", "a1", "fuse"}. The unnamed ones are "input" / "output" if there is only
+    // one, otherwise "input:<node>" ("input:<node>.k" for the k-th port of the node, k > 0).
+    // A node with several inputs takes the frames with the same id from them, the older
+    // ones (smaller ids) are dropped, so the ids fed to each port should be increasing.
     void BuildGraph(std::vector<std::vector<std::string>> &&relation);
+    // The node keeps size bytes of state for each stream, zeroed before the first frame of
+    // the stream, and its task gets it by TaskContext::State(). The frames of a stream run
+    // one by one on the node, so the replicas of the node are disabled.
+    // The delay edges are shared by all the streams, use it for the per-stream state instead.
+    void DeclareNodeState(const std::string &name, uint32_t size);
     void ShowInfo(); // 不只是graph的，还包含其他内容
+    // Replace the group ids given in CreateNode: run each node num_iter times with the sample
+    // input to measure its cost, then split the graph into num_thread groups to balance the
+    // pipeline stages. The chosen groups and the predicted throughput are printed.
+    // Call it after BuildGraph and before Start, GroupAttr::group_id refers to the new groups.
+    // Not available if the chains are fused, see SessionConfig::fuse_chains.
+    // The node states written by the sample runs are dropped, see DeclareNodeState.
+    // The graph should have only one input port and one output port for the sample.
+    void GraphCalibrate(void *usr, ITensor *sample, int num_iter = 10);
 
     void Start(void *usr);
     void Stop();
 
-    // Asynchronous function.
+    // Asynchronous function. In SERIAL mode, it runs the whole graph before returning.
     void GraphFeed(ITensor *in);
     // Get the result after calling the Feed.
+    // In SERIAL mode, it is the result of the latest Feed.
     void GraphGetResult(ITensor *out);
+    // Multi-stream: the frames of several streams (stream_id >= 0) share one graph, with its
+    // threads and memory. The frame is tagged with the stream id, and GraphGetResult returns
+    // the next result of the stream. The results of the other streams are kept for them,
+    // so that a stream not taking its results will block the others when the slots run out.
+    void GraphFeed(ITensor *in, int stream_id);
+    void GraphGetResult(ITensor *out, int stream_id);
+    // Feed an urgent frame with priority > 0, see ITensor::priority. The dropping policies
+    // drop the normal frames first. stream_id < 0 for none.
+    void GraphFeed(ITensor *in, int stream_id, int priority);
+    // Multiple graph ports, see BuildGraph. The functions without the port name use the first
+    // input / output port. In SERIAL mode, the graph runs once all the input ports have been
+    // fed with the same id. The port can be given without the prefix, like "video" for "input:video".
+    void GraphFeed(const std::string &port, ITensor *in);
+    void GraphGetResult(const std::string &port, ITensor *out);
+
+    // Asynchronous version of GraphFeed + GraphGetResult, matched by the tensor id, so the
+    // ids of the frames in flight should be unique. The result of this frame does not go to
+    // GraphGetResult, instead:
+    // 1. it is copied to out, then the future becomes ready;
+    // 2. done is called with it on the worker thread, the tensor is only valid in done.
+    // The pending requests are abandoned by Stop (std::future_error for the future).
+    // In SERIAL mode, the graph runs before returning. The graph should have only one output port.
+    std::future<void> GraphFeedAsync(ITensor *in, ITensor *out);
+    void GraphFeedAsync(ITensor *in, std::function<void(ITensor *out)> &&done);
+
+    // Number of frames dropped by the overflow policy of the edge, or by the id matching of
+    // the join. The nodes and graph ports are named as in BuildGraph, like ("input", "n1"),
+    // also for the nodes fused in a chain.
+    int64_t GraphGetDroppedFrames(const std::string &front, const std::string &rear);
+    // Number of slots of the edge, set by depth=N or tuned by depth=auto, -1 if not found.
+    int GraphGetEdgeDepth(const std::string &front, const std::string &rear);
+
+    // Zero-copy io. GraphFeed / GraphGetResult copy the whole tensor into / out of the graph,
+    // these lend the internal tensors instead:
+    // Borrow -> fill data and set id -> Submit; Take -> read -> Release.
+    // Borrow and Take block until a tensor is available, and return nullptr after Stop.
+    // A borrowed tensor must be submitted, and a taken one must be released, otherwise
+    // the graph will run out of tensors.
+    // In SERIAL mode, Submit runs the whole graph, and the taken result is valid until the next Submit.
+    ITensor *GraphBorrowInput();
+    void GraphSubmitInput(ITensor *in);
+    ITensor *GraphTakeResult();
+    void GraphReleaseResult(ITensor *out);
     
 private:
     void *params_;
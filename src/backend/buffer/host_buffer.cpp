@@ -1,28 +1,76 @@
 
 #include "host_buffer.hpp"
 
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 #include "util/logger.hpp"
 
 namespace ecas {
 
-HostBuffer::HostBuffer(uint32_t size) {
+HostBuffer::HostBuffer(uint32_t size, uint32_t alignment, bool is_huge_page) {
     data_ = nullptr;
-    data_ = malloc(size);
-    memset(data_, 0, size);
     size_ = size;
     is_owned_ = true;
+    is_mapped_ = false;
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+        ECAS_LOGE("HostBuffer -> The alignment %u should be a power of 2.\n", alignment);
+
+#if defined(__linux__)
+    if (is_huge_page && size >= ECAS_HUGE_PAGE_SIZE) {
+        // The reserved huge pages are zeroed, see /proc/sys/vm/nr_hugepages.
+        size_t mapped_size = ((size_t)size + ECAS_HUGE_PAGE_SIZE - 1) / ECAS_HUGE_PAGE_SIZE * ECAS_HUGE_PAGE_SIZE;
+        void *data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            data_ = data;
+            is_mapped_ = true;
+            return;
+        }
+        // Transparent huge pages, the range should be aligned to the huge page.
+        alignment = std::max<uint32_t>(alignment, ECAS_HUGE_PAGE_SIZE);
+    }
+#endif
+
+#if defined(_WIN32)
+    data_ = _aligned_malloc(size, alignment);
+#else
+    if (posix_memalign(&data_, alignment, size) != 0)
+        data_ = nullptr;
+#endif
+    if (data_ == nullptr)
+        ECAS_LOGE("HostBuffer -> Failed to allocate %u bytes.\n", size);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (is_huge_page && size >= ECAS_HUGE_PAGE_SIZE)
+        madvise(data_, size, MADV_HUGEPAGE);
+#endif
+    memset(data_, 0, size);
 }
 
 HostBuffer::HostBuffer(uint32_t size, void *data) {
     data_ = data;
     size_ = size;
     is_owned_ = false;
+    is_mapped_ = false;
 }
 
 HostBuffer::~HostBuffer() {
     if (is_owned_ == true && data_ != nullptr) {
+#if defined(__linux__)
+        if (is_mapped_) {
+            munmap(data_, ((size_t)size_ + ECAS_HUGE_PAGE_SIZE - 1) / ECAS_HUGE_PAGE_SIZE * ECAS_HUGE_PAGE_SIZE);
+            data_ = nullptr;
+            return;
+        }
+#endif
+#if defined(_WIN32)
+        _aligned_free(data_);
+#else
         free(data_);
+#endif
         data_ = nullptr;
     }
 }
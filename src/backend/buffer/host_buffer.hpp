@@ -1,7 +1,7 @@
 /*!
 * \brief HostBuffer
 *        host端buffer实现类
-*        1. 自己开的内存; 2. 外部设的内存。
+*        1. 自己开的内存, 按alignment对齐, 大块内存可使用大页; 2. 外部设的内存。
 */
 
 #ifndef ECAS_BACKEND_EXTERNAL_HOST_BUFFER_HPP_
@@ -11,18 +11,26 @@
 
 namespace ecas {
 
+#define ECAS_HOST_ALIGNMENT 64
+#define ECAS_HUGE_PAGE_SIZE (2 << 20)
+
 class HostBuffer: public Buffer {
 public:
-    HostBuffer(uint32_t size);
+    // Zeroed, the address is a multiple of alignment (a power of 2).
+    // is_huge_page: if size >= ECAS_HUGE_PAGE_SIZE, it is backed by huge pages, from the
+    // reserved pool (MAP_HUGETLB) if possible, otherwise by madvise(MADV_HUGEPAGE).
+    HostBuffer(uint32_t size, uint32_t alignment = ECAS_HOST_ALIGNMENT, bool is_huge_page = false);
     HostBuffer(uint32_t size, void *data);
     ~HostBuffer();
 
     inline void *data() { return data_; }
+    inline uint32_t size() { return size_; }
 
 private:
     uint32_t size_;
     void *data_;
     bool is_owned_;
+    bool is_mapped_; // Freed by munmap.
 };
 
 }  // end of namespace ecas
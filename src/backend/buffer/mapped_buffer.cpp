@@ -0,0 +1,68 @@
+/*!
+* \brief MappedBuffer
+*/
+
+#include "mapped_buffer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "util/logger.hpp"
+
+namespace ecas {
+
+MappedBuffer::MappedBuffer(const std::string &path, uint64_t offset, uint32_t size, MapPrefetch prefetch) {
+    size_ = size;
+#if defined(_WIN32)
+    // No mapping here, read it into the heap instead.
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr)
+        ECAS_LOGE("MappedBuffer -> Can not open %s.\n", path.c_str());
+    base_ = malloc(size);
+    mapped_size_ = size;
+    if (_fseeki64(fp, offset, SEEK_SET) != 0 || fread(base_, 1, size, fp) != size)
+        ECAS_LOGE("MappedBuffer -> %s is smaller than %llu + %u bytes.\n", path.c_str(), (unsigned long long)offset, size);
+    fclose(fp);
+    data_ = base_;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        ECAS_LOGE("MappedBuffer -> Can not open %s.\n", path.c_str());
+    struct stat st;
+    if (fstat(fd, &st) != 0 || offset + size > (uint64_t)st.st_size)
+        ECAS_LOGE("MappedBuffer -> %s is smaller than %llu + %u bytes.\n", path.c_str(), (unsigned long long)offset, size);
+
+    // The offset of mmap should be a multiple of the page size.
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    uint64_t aligned_offset = offset / page_size * page_size;
+    mapped_size_ = offset - aligned_offset + size;
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    if (prefetch == PREFETCH_POPULATE)
+        flags |= MAP_POPULATE;
+#endif
+    base_ = mmap(nullptr, mapped_size_, PROT_READ, flags, fd, aligned_offset);
+    // The mapping keeps the file referenced.
+    close(fd);
+    if (base_ == MAP_FAILED)
+        ECAS_LOGE("MappedBuffer -> Failed to map %s.\n", path.c_str());
+    if (prefetch == PREFETCH_ASYNC)
+        madvise(base_, mapped_size_, MADV_WILLNEED);
+    data_ = (char *)base_ + (offset - aligned_offset);
+#endif
+}
+
+MappedBuffer::~MappedBuffer() {
+#if defined(_WIN32)
+    free(base_);
+#else
+    munmap(base_, mapped_size_);
+#endif
+}
+
+}  // namespace ecas
@@ -0,0 +1,34 @@
+/*!
+* \brief MappedBuffer
+*        文件映射的只读host buffer，多个session或进程映射同一文件时共享page cache中的同一份数据。
+*/
+
+#ifndef ECAS_BACKEND_BUFFER_MAPPED_BUFFER_HPP_
+#define ECAS_BACKEND_BUFFER_MAPPED_BUFFER_HPP_
+
+#include <string>
+
+#include "core/buffer.hpp"
+#include "ecas/ecas.hpp"
+
+namespace ecas {
+
+class MappedBuffer: public Buffer {
+public:
+    // Map size bytes of the file from offset, which needs not be aligned to the page.
+    MappedBuffer(const std::string &path, uint64_t offset, uint32_t size, MapPrefetch prefetch = PREFETCH_NONE);
+    ~MappedBuffer();
+
+    inline void *data() { return data_; }
+    inline uint32_t size() { return size_; }
+
+private:
+    uint32_t size_;
+    void *data_;
+    void *base_;         // The start of the mapping, aligned to the page.
+    size_t mapped_size_;
+};
+
+}  // end of namespace ecas
+
+#endif  // ECAS_BACKEND_BUFFER_MAPPED_BUFFER_HPP_
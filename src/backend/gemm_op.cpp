@@ -38,8 +38,15 @@ void GemmOp::Run(std::vector<Param> &params, std::vector<ITensor *> &inputs, std
     int N = outputs[0]->shape()[1]; // W
     int K = inputs[0]->shape()[1];
 
+    // The views keep the rows apart by their strides, see Session::SliceITensor.
+    if (inputs[0]->strides()[1] != 1 || inputs[1]->strides()[1] != 1 || outputs[0]->strides()[1] != 1)
+        ECAS_LOGE("GemmOp::Run -> The rows should be contiguous.\n");
+    int lda = inputs[0]->strides()[0];
+    int ldb = inputs[1]->strides()[0];
+    int ldc = outputs[0]->strides()[0];
+
     // printf("GemmOp::Run: %d, %d, %d, %d, %d.\n", inputs.size(), outputs.size(), M, N, K);
-    cpu_dispatcher_->GemmKernel(M, N, K, params_.alpha, A, K, B, N, C, N);
+    cpu_dispatcher_->GemmKernel(M, N, K, params_.alpha, A, lda, B, ldb, C, ldc);
 }
 
 }  // end of namespace ecas.
\ No newline at end of file
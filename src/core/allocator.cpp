@@ -3,36 +3,250 @@
 */
 
 #include "allocator.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include "node.hpp"
+#include "util/timer.hpp"
 #include "backend/buffer/host_buffer.hpp"
+#include "backend/buffer/mapped_buffer.hpp"
 #include "backend/buffer/vulkan_buffer.hpp"
 #include "util/logger.hpp"
 
 namespace ecas {
 
 #define ECAS_BLOCKING_QUEUE_SIZE 10
+// Auto depth: frames in a tuning window, number of windows for warm-up, and the max depth.
+#define ECAS_TUNE_WINDOW_FRAMES 32
+#define ECAS_TUNE_WINDOWS 8
+#define ECAS_TUNE_MAX_DEPTH 64
+
+/////////////////////////////////////////////
+// BlockingQueuePair
+/////////////////////////////////////////////
+
+// Decrease the counter only if it stays >= floor, returns the value before
+// decreasing, or 0 if failed.
+static inline int TryDecrease(std::atomic<int> &counter, int floor) {
+    int num = counter.load();
+    while (num > floor) {
+        if (counter.compare_exchange_weak(num, num - 1))
+            return num;
+    }
+    return 0;
+}
+
+// Decrease the counter before popping and increase it after pushing.
+// The free slots of an edge with a dropping policy are not a condition for the
+// producer to run, so its producer is not informed.
+void BlockingQueuePair::OnFreeTaken(int num) {
+    if (tuner.load() != nullptr) {
+        std::unique_lock<std::mutex> lock(tune_mutex);
+        if (num == 1) blocked_since = util::NowNs();
+        min_free = std::min(min_free, num - 1);
+    }
+    if (num == 1 && producer != nullptr && overflow == OVERFLOW_BLOCK)
+        producer->OnPortChanged(false);
+}
+
+void BlockingQueuePair::OnFullTaken(int num) {
+    if (num == 1) {
+        if (tuner.load() != nullptr) {
+            std::unique_lock<std::mutex> lock(tune_mutex);
+            starved_since = util::NowNs();
+        }
+        if (consumer != nullptr) consumer->OnPortChanged(false);
+    }
+}
+
+void BlockingQueuePair::OnFramePushed() {
+    Allocator *allocator = tuner.load();
+    if (allocator == nullptr)
+        return;
+    {
+        std::unique_lock<std::mutex> lock(tune_mutex);
+        if (++num_pushed < ECAS_TUNE_WINDOW_FRAMES)
+            return;
+    }
+    allocator->TuneBlockingQueue(this);
+}
+
+bool BlockingQueuePair::PopFree(Tensor **t) {
+    OnFreeTaken(num_free.fetch_sub(1));
+    return free.wait_and_pop(t);
+}
+
+bool BlockingQueuePair::AcquireFree(Tensor **t) {
+    if (overflow == OVERFLOW_BLOCK)
+        return PopFree(t);
+    int num = TryDecrease(num_free, 0);
+    if (num > 0) {
+        OnFreeTaken(num);
+        return free.wait_and_pop(t);
+    }
+    if (overflow == DROP_NEWEST) {
+        *t = discard;
+        return true;
+    }
+    // DROP_OLDEST / KEEP_LATEST: take back the oldest frame that is not consumed yet,
+    // the normal ones first.
+    {
+        std::unique_lock<std::mutex> lock(drop_mutex);
+        if (ReserveFull()) {
+            num_dropped++;
+            return TakeFull(t, false);
+        }
+    }
+    // All the slots are being used by the nodes, wait for one.
+    return PopFree(t);
+}
+
+void BlockingQueuePair::PushFull(Tensor *t) {
+    if (t == discard) {
+        num_dropped++;
+        return;
+    }
+    if (deliver && deliver(t)) {
+        PushFree(t);
+        return;
+    }
+    if (!branches.empty()) {
+        t->SetRefCount(branches.size());
+        for (int i = 0; i < branches.size(); i++)
+            branches[i]->PushFull(t);
+        OnFramePushed();
+        return;
+    }
+    bool is_urgent = t->priority() > 0;
+    full.push(t, is_urgent);
+    if (num_full.fetch_add(1) == 0) {
+        if (is_profiling) full_ready_ns = util::NowNs();
+        if (tuner.load() != nullptr) {
+            std::unique_lock<std::mutex> lock(tune_mutex);
+            starved_ns += std::max<int64_t>(0, util::NowNs() - starved_since);
+        }
+        if (consumer != nullptr) consumer->OnPortChanged(true);
+    }
+    if (consumer != nullptr)
+        consumer->OnInputPushed(is_urgent);
+    // Only the newest one is kept for the consumer, an urgent one is dropped after the normal ones.
+    if (overflow == KEEP_LATEST) {
+        std::unique_lock<std::mutex> lock(drop_mutex);
+        while (TryDecrease(num_full, 1) > 0) {
+            Tensor *old;
+            if (!full.try_pop(&old, false))
+                break;
+            num_dropped++;
+            PushFree(old);
+        }
+    }
+    OnFramePushed();
+}
+
+bool BlockingQueuePair::PopFull(Tensor **t) {
+    OnFullTaken(num_full.fetch_sub(1));
+    return full.wait_and_pop(t);
+}
+
+bool BlockingQueuePair::ReserveFull() {
+    int num = TryDecrease(num_full, 0);
+    if (num == 0)
+        return false;
+    OnFullTaken(num);
+    return true;
+}
+
+void BlockingQueuePair::UnreserveFull() {
+    if (num_full.fetch_add(1) == 0 && consumer != nullptr)
+        consumer->OnPortChanged(true);
+}
+
+bool BlockingQueuePair::TakeFull(Tensor **t, bool is_urgent_first) {
+    return full.wait_and_pop(t, is_urgent_first);
+}
+
+bool BlockingQueuePair::PeekFull(Tensor **t, bool is_urgent) {
+    return full.try_front_lane(t, is_urgent);
+}
+
+void BlockingQueuePair::PushFree(Tensor *t) {
+    if (source != nullptr) {
+        if (t->Unref() == 0)
+            source->PushFree(t);
+        return;
+    }
+    free.push(t);
+    if (num_free.fetch_add(1) == 0) {
+        if (is_profiling) free_ready_ns = util::NowNs();
+        if (tuner.load() != nullptr) {
+            std::unique_lock<std::mutex> lock(tune_mutex);
+            blocked_ns += std::max<int64_t>(0, util::NowNs() - blocked_since);
+        }
+        if (producer != nullptr && overflow == OVERFLOW_BLOCK) producer->OnPortChanged(true);
+    }
+}
+
+void BlockingQueuePair::Enqueue(ITensor *input) {
+    Tensor *inside_free;
+    if (!AcquireFree(&inside_free))
+        return;
+    if (inside_free == discard) {
+        num_dropped++;
+        return;
+    }
+    inside_free->CopyFrom(input);
+    PushFull(inside_free);
+}
+
+void BlockingQueuePair::Dequeue(ITensor *output) {
+    Tensor *inside_full;
+    if (!PopFull(&inside_full))
+        return;
+    inside_full->CopyTo(output);
+    PushFree(inside_full);
+}
+
+/////////////////////////////////////////////
+// Allocator
+/////////////////////////////////////////////
 
 Allocator::~Allocator() {
     // BlockingQueue
+    // The tensors of a source waiting in its branches are in none of its own queues,
+    // and may be in several branches.
+    std::set<Tensor *> branch_tensors;
     for (int i = 0; i < bq_pairs_.size(); i++) {
         BlockingQueuePair *bqp = bq_pairs_[i];
-        while (!bqp->free.empty()) {
-            Tensor *t;
-            bqp->free.wait_and_pop(&t);
+        Tensor *t;
+        if (bqp->source != nullptr) {
+            while (bqp->full.try_pop(&t))
+                branch_tensors.insert(t);
+            delete bqp;
+            continue;
+        }
+        // The queues may have been exited, so use try_pop.
+        while (bqp->free.try_pop(&t)) {
             delete t;
         }
-        while (!bqp->full.empty()) {
-            Tensor *t;
-            bqp->full.wait_and_pop(&t);
+        while (bqp->full.try_pop(&t)) {
             delete t;
         }
+        if (bqp->discard != nullptr)
+            delete bqp->discard;
         delete bqp;
     }
+    for (std::set<Tensor *>::iterator iter = branch_tensors.begin(); iter != branch_tensors.end(); iter++)
+        delete *iter;
     bq_pairs_.clear();
     std::vector<BlockingQueuePair *>().swap(bq_pairs_);
     
-    // Buffers
+    // Buffers, freed by the pool.
     for (int i=0; i<buffers_.size(); i++) {
-        delete buffers_[i];
+        pool_.Release(buffers_[i]);
+    }
+    for (int i=0; i<mapped_buffers_.size(); i++) {
+        delete mapped_buffers_[i];
     }
     // Tensors
     for (int i=0; i<tensors_.size(); i++) {
@@ -43,7 +257,7 @@ Allocator::~Allocator() {
 Buffer* Allocator::CreateBuffer(MemoryType type, uint32_t size) {
     switch (type) {
         case ONLY_ON_HOST: 
-            return new HostBuffer(size);
+            return pool_.Acquire(size);
         // case ONLY_ON_DEVICE:
         //     return new Buffer();
         // case ON_HOST_AND_DEVICE:
@@ -53,26 +267,149 @@ Buffer* Allocator::CreateBuffer(MemoryType type, uint32_t size) {
     }
 }
 
-BlockingQueuePair *Allocator::CreateBlockingQueue(std::vector<int> &shape, DataType type) {
-    BlockingQueuePair *bqp = new BlockingQueuePair;
-    for (int i=0; i<ECAS_BLOCKING_QUEUE_SIZE; i++) {
-        Tensor *t = new Tensor(shape, type);
-        Buffer *buffer = CreateBuffer(ONLY_ON_HOST, t->size());
-        t->BindBuffer(buffer);
-        bqp->free.push(t);
+Tensor *Allocator::CreateQueueSlot(std::vector<int> &shape, DataType type) {
+    Tensor *t = new Tensor(shape, type);
+    Buffer *buffer = CreateBuffer(ONLY_ON_HOST, t->size());
+    t->BindBuffer(buffer);
 
-        buffers_.push_back(buffer);
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffers_.push_back(buffer);
+    queue_bytes_ += t->size();
+    return t;
+}
+
+void Allocator::ReleaseQueueSlot(Tensor *t) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Buffer *>::iterator iter = std::find(buffers_.begin(), buffers_.end(), t->buffer());
+    if (iter != buffers_.end()) {
+        pool_.Release(*iter);
+        buffers_.erase(iter);
     }
+    queue_bytes_ -= t->size();
+    delete t;
+}
+
+BlockingQueuePair *Allocator::CreateBlockingQueue(std::vector<int> &shape, DataType type,
+                                                  int depth, bool is_auto_depth) {
+    if (depth <= 0)
+        depth = ECAS_BLOCKING_QUEUE_SIZE;
+
+    BlockingQueuePair *bqp = new BlockingQueuePair;
+    bqp->shape = shape;
+    bqp->type = type;
+    // The slots can be grown up to ECAS_TUNE_MAX_DEPTH by the producer in auto depth mode,
+    // while the consumer is recycling.
+    int capacity = is_auto_depth ? std::max(depth, ECAS_TUNE_MAX_DEPTH) : depth;
+    bqp->free.Reserve(capacity);
+    bqp->full.Reserve(capacity);
+    if (is_auto_depth)
+        bqp->free.SetMultiProducer(true);
+    for (int i=0; i<depth; i++) {
+        bqp->PushFree(CreateQueueSlot(shape, type));
+    }
+    bqp->depth = depth;
+    if (is_auto_depth) {
+        bqp->min_free = depth;
+        bqp->window_start = util::NowNs();
+        bqp->tuner = this;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
     bq_pairs_.push_back(bqp);
     return bqp;
 }
 
+void Allocator::SetDelay(BlockingQueuePair *bqp, float value) {
+    Tensor *t;
+    bqp->PopFree(&t);
+    t->Fill(value);
+    t->SetId(-1);
+    bqp->PushFull(t);
+    bqp->is_delay = true;
+}
+
+void Allocator::SetOverflowPolicy(BlockingQueuePair *bqp, OverflowPolicy policy) {
+    bqp->overflow = policy;
+    if (policy == OVERFLOW_BLOCK)
+        return;
+    // The producer takes back the frames not consumed yet.
+    bqp->full.SetMultiConsumer(true);
+    bqp->free.SetMultiProducer(true);
+    // The frames dropped at once are written to it.
+    if (policy == DROP_NEWEST && bqp->discard == nullptr)
+        bqp->discard = CreateQueueSlot(bqp->shape, bqp->type);
+}
+
+BlockingQueuePair *Allocator::CreateBranchQueue(BlockingQueuePair *source) {
+    BlockingQueuePair *bqp = new BlockingQueuePair;
+    bqp->source = source;
+    bqp->shape = source->shape;
+    bqp->type = source->type;
+    bqp->full.Reserve(source->free.capacity());
+    // All the consumers recycle to the source.
+    source->free.SetMultiProducer(true);
+    source->branches.push_back(bqp);
+    std::unique_lock<std::mutex> lock(mutex_);
+    bq_pairs_.push_back(bqp);
+    return bqp;
+}
+
+// It is called by the producer of the queue at the end of each window.
+// 1. The producer is blocked and the consumer is starved at times: the frames are bursty,
+//    a deeper queue can absorb the bursts, so grow it.
+// 2. The producer is hardly blocked: some slots are never used, release them but keep one spare.
+// 3. Otherwise, the consumer is the bottleneck, more slots only add latency and memory.
+void Allocator::TuneBlockingQueue(BlockingQueuePair *bqp) {
+    int64_t now = util::NowNs();
+    int64_t window_ns, blocked_ns, starved_ns;
+    int min_free;
+    {
+        std::unique_lock<std::mutex> lock(bqp->tune_mutex);
+        window_ns = std::max<int64_t>(1, now - bqp->window_start);
+        blocked_ns = bqp->blocked_ns;
+        starved_ns = bqp->starved_ns;
+        min_free = bqp->min_free;
+        bqp->blocked_ns = 0;
+        bqp->starved_ns = 0;
+        bqp->min_free = bqp->num_free;
+    }
+
+    int depth = bqp->depth;
+    if (blocked_ns * 20 > window_ns && starved_ns * 20 > window_ns) {
+        int num = std::min(std::max(1, depth / 2), ECAS_TUNE_MAX_DEPTH - depth);
+        for (int i = 0; i < num; i++) {
+            bqp->PushFree(CreateQueueSlot(bqp->shape, bqp->type));
+            bqp->depth++;
+        }
+    }
+    else if (blocked_ns * 100 < window_ns && min_free > 1) {
+        for (int i = 0; i < min_free - 1; i++) {
+            if (bqp->num_free <= 1)
+                break;
+            Tensor *t;
+            if (!bqp->PopFree(&t))
+                break;
+            ReleaseQueueSlot(t);
+            bqp->depth--;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(bqp->tune_mutex);
+    bqp->num_pushed = 0;
+    bqp->window_start = now;
+    if (++bqp->num_window >= ECAS_TUNE_WINDOWS) {
+        bqp->tuner = nullptr;
+        ECAS_LOGI("TuneBlockingQueue -> [%s, %s]: depth %d.\n",
+                  bqp->front_name.c_str(), bqp->rear_name.c_str(), (int)bqp->depth);
+    }
+}
+
 Tensor *Allocator::CreateTensor(std::vector<int> &shape, DataType type, void *data) {
     Tensor *t = new Tensor(shape, type);
+    std::unique_lock<std::mutex> lock(mutex_);
     if (data != nullptr)
         t->BindHostDataPtr(data);
     else {
-        Buffer *buffer = CreateBuffer(ONLY_ON_HOST, t->size());  // TODO: 所有的CreateBuffer外都需要再嵌套一层，检查是否有空余可复用的内存。
+        Buffer *buffer = CreateBuffer(ONLY_ON_HOST, t->size());
         t->BindBuffer(buffer);
         buffers_.push_back(buffer);
     }
@@ -80,16 +417,97 @@ Tensor *Allocator::CreateTensor(std::vector<int> &shape, DataType type, void *da
     return t;
 }
 
+Tensor *Allocator::CreateMappedTensor(const std::string &path, uint64_t offset, std::vector<int> &shape,
+                                      DataType type, MapPrefetch prefetch) {
+    Tensor *t = new Tensor(shape, type);
+    Buffer *buffer = new MappedBuffer(path, offset, t->size(), prefetch);
+    t->BindBuffer(buffer);
+    std::unique_lock<std::mutex> lock(mutex_);
+    mapped_buffers_.push_back(buffer);
+    tensors_.push_back(t);
+    return t;
+}
+
+Tensor *Allocator::CreateView(Tensor *parent, std::vector<int> &shape, std::vector<int> &strides, uint32_t offset) {
+    Tensor *t = new Tensor(shape, parent->type());
+    t->BindView(parent, strides, offset);
+    std::unique_lock<std::mutex> lock(mutex_);
+    tensors_.push_back(t);
+    return t;
+}
+
+void Allocator::ReleaseTensor(Tensor *t) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Tensor *>::iterator iter = std::find(tensors_.begin(), tensors_.end(), t);
+    if (iter == tensors_.end()) {
+        ECAS_LOGW("Allocator::ReleaseTensor -> The tensor is not created by CreateTensor.\n");
+        return;
+    }
+    tensors_.erase(iter);
+    // The buffer of a view belongs to its parent.
+    if (t->is_view()) {
+        delete t;
+        return;
+    }
+    std::vector<Buffer *>::iterator buffer_iter = std::find(buffers_.begin(), buffers_.end(), t->buffer());
+    if (buffer_iter != buffers_.end()) {
+        pool_.Release(*buffer_iter);
+        buffers_.erase(buffer_iter);
+    }
+    buffer_iter = std::find(mapped_buffers_.begin(), mapped_buffers_.end(), t->buffer());
+    if (buffer_iter != mapped_buffers_.end()) {
+        delete *buffer_iter;
+        mapped_buffers_.erase(buffer_iter);
+    }
+    delete t;
+}
+
+Buffer *Allocator::CreateArena(uint32_t size) {
+    Buffer *buffer = CreateBuffer(ONLY_ON_HOST, size);
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffers_.push_back(buffer);
+    return buffer;
+}
+
+void Allocator::ReleaseArena(Buffer *buffer) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<Buffer *>::iterator iter = std::find(buffers_.begin(), buffers_.end(), buffer);
+    if (iter == buffers_.end()) {
+        ECAS_LOGW("Allocator::ReleaseArena -> The buffer is not created by CreateArena.\n");
+        return;
+    }
+    pool_.Release(*iter);
+    buffers_.erase(iter);
+}
+
 void Allocator::PrintInfo() {
-    ECAS_LOGS("Allocator info:\n");
+    MemoryStats stats = pool_.stats();
+    ECAS_LOGS("Allocator info: %u bytes in queue slots.\n", queue_bytes_);
+    ECAS_LOGS("Buffer pool: %llu bytes in use, %llu bytes cached, %llu hits, %llu misses.\n",
+              (unsigned long long)stats.bytes_in_use, (unsigned long long)stats.bytes_cached,
+              (unsigned long long)stats.hits, (unsigned long long)stats.misses);
     for (int i = 0; i < bq_pairs_.size(); i++) {
         BlockingQueuePair *bqp = bq_pairs_[i];
-        ECAS_LOGS("[%s, %s]: (full: %d, free: %d).\n", 
+        if (bqp->source != nullptr) {
+            ECAS_LOGS("[%s, %s]: (full: %d, branch).\n", 
+                      bqp->front_name.c_str(), bqp->rear_name.c_str(), bqp->full.size());
+            continue;
+        }
+        ECAS_LOGS("[%s, %s]: (full: %d, free: %d, depth: %d%s", 
                   bqp->front_name.c_str(), bqp->rear_name.c_str(),
-                  bqp->full.size(), bqp->free.size());
+                  bqp->full.size(), bqp->free.size(), (int)bqp->depth,
+                  bqp->tuner.load() != nullptr ? ", tuning" : "");
+        if (bqp->overflow != OVERFLOW_BLOCK)
+            ECAS_LOGS(", dropped: %lld", (long long)bqp->num_dropped);
+        ECAS_LOGS(").\n");
     }
 }
 
+void Allocator::GetBlockingQueues(std::vector<BlockingQueuePair *> *queues) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    *queues = bq_pairs_;
+}
+
 void Allocator::ExitAllBlockingQueue() {
     for (int i=0; i<bq_pairs_.size(); i++) {
         BlockingQueuePair *bqp = bq_pairs_[i];
@@ -5,9 +5,14 @@
 #ifndef ECAS_CORE_TENSOR_POOL_HPP_
 #define ECAS_CORE_TENSOR_POOL_HPP_
 
+#include <atomic>
+#include <mutex>
+#include <functional>
+
 #include "tensor.hpp"
 #include "buffer.hpp"
-#include "util/blocking_queue.hpp"
+#include "buffer_pool.hpp"
+#include "util/spsc_queue.hpp"
 
 /*
         Allocator
@@ -16,6 +21,9 @@
 */
 namespace ecas {
 
+class Node;
+class Allocator;
+
 // TODO: 兼并同步模式，不使用blocking_queue. 提供统一对外的结构体
 // TODO: tensor和buffer平级，tensor可以和不同buffer绑定。
 //       buffer有size的概念，tensor有shape，只要size大于tensor所需size，即可绑定
@@ -23,47 +31,151 @@ namespace ecas {
 struct BlockingQueuePair {
     std::string front_name;
     std::string rear_name;
-    util::BlockingQueue<Tensor *> free;
-    util::BlockingQueue<Tensor *> full;
-
-    void Enqueue(ITensor *input) {
-        Tensor *inside_free;
-        free.wait_and_pop(&inside_free);
-        inside_free->CopyFrom(input);
-        full.push(inside_free);
-    }
-
-    void Dequeue(ITensor *output) {
-        Tensor *inside_full;
-        full.wait_and_pop(&inside_full);
-        inside_full->CopyTo(output);
-        free.push(inside_full);
-    }
-
-    void LoanOutFromFull(Tensor **out_full) {
-        full.try_pop(out_full);
-    }
-
-    void RecycleToFree(Tensor *in_free) {
-        free.push(in_free);
-    }
+    // Each queue has one pusher and one popper in general, so the lock-free ring is used.
+    // The side shared by several threads is locked, see Allocator::CreateBlockingQueue.
+    // The urgent frames (ITensor::priority > 0) are in the urgent lane of full.
+    util::SpscQueue<Tensor *> free;
+    util::SpscQueue<Tensor *> full;
+    // Shape and type of the slots.
+    std::vector<int> shape;
+    DataType type;
+
+    // The nodes on both sides, nullptr for the input / output of the graph.
+    // They will be informed when the corresponding queue becomes empty or not.
+    Node *producer;
+    Node *consumer;
+    // num_full / num_free never exceed the real size of full / free, so the single
+    // consumer / producer can pop without blocking when they are greater than 0.
+    std::atomic<int> num_full;
+    std::atomic<int> num_free;
+
+    // Broadcast edge: one output of the producer is shared by several consumers.
+    // The source pair holds the slots and is the output queue of the producer, each
+    // consumer reads from its own branch pair, which has the full queue only.
+    // A tensor pushed to the source goes to all the branches with a reference count,
+    // and goes back to the free queue of the source after the last consumer releases it.
+    std::vector<BlockingQueuePair *> branches;
+    BlockingQueuePair *source; // Not nullptr for a branch.
+
+    // Number of slots, can be changed by Allocator::TuneBlockingQueue with depth=auto.
+    std::atomic<int> depth;
+    // Not nullptr in auto depth mode, cleared by the producer when the tuning is done.
+    std::atomic<Allocator *> tuner;
+    // Statistics in the current tuning window, updated by both sides under tune_mutex.
+    std::mutex tune_mutex;
+    int64_t blocked_ns;    // The producer has no free slot.
+    int64_t starved_ns;    // The consumer has no data.
+    int64_t blocked_since;
+    int64_t starved_since;
+    int min_free;          // The fewest unused slots.
+    int num_pushed;
+    int64_t window_start;
+    int num_window;
+
+    // What the producer does when there is no free slot, see OverflowPolicy.
+    OverflowPolicy overflow;
+    Tensor *discard; // DROP_NEWEST only, the dropped frames are written to it.
+    std::atomic<int64_t> num_dropped;
+    // DROP_OLDEST / KEEP_LATEST: held by the producer while it takes the frames back, and
+    // by a join from peeking at the head to taking it, see Node::BorrowIo.
+    std::mutex drop_mutex;
+
+    // Feedback edge, its data comes from the former frame, see Allocator::SetDelay.
+    bool is_delay;
+
+    // If set, it is called before a tensor is pushed to full. Returns true if it has
+    // consumed the tensor, and the tensor goes back to free directly.
+    std::function<bool(Tensor *)> deliver;
+
+    // For the profiler, the time when the queue became non-empty last.
+    bool is_profiling;
+    std::atomic<int64_t> full_ready_ns;
+    std::atomic<int64_t> free_ready_ns;
+
+    BlockingQueuePair(): producer(nullptr), consumer(nullptr), num_full(0), num_free(0),
+                         source(nullptr), depth(0), tuner(nullptr), blocked_ns(0), starved_ns(0),
+                         blocked_since(0), starved_since(0), min_free(0),
+                         num_pushed(0), window_start(0), num_window(0),
+                         overflow(OVERFLOW_BLOCK), discard(nullptr), num_dropped(0), is_delay(false),
+                         is_profiling(false), full_ready_ns(0), free_ready_ns(0) {}
+
+    // Producer side.
+    bool PopFree(Tensor **t);
+    // PopFree with the overflow policy, it may take back the oldest full slot, or
+    // return the discard tensor, instead of waiting for a free slot.
+    bool AcquireFree(Tensor **t);
+    void PushFull(Tensor *t);
+    // Consumer side.
+    bool PopFull(Tensor **t);
+    // Reserve one full slot without blocking, then take it, or give it up.
+    // The producer may take back the full slots with a dropping policy.
+    bool ReserveFull();
+    void UnreserveFull();
+    bool TakeFull(Tensor **t, bool is_urgent_first = true);
+    // The head of the lane, call it with a reserved slot.
+    bool PeekFull(Tensor **t, bool is_urgent);
+    void PushFree(Tensor *t);
+
+    void Enqueue(ITensor *input);
+    void Dequeue(ITensor *output);
+
+private:
+    // Update the statistics and inform the nodes, num is the count before taking.
+    void OnFreeTaken(int num);
+    void OnFullTaken(int num);
+    // Auto depth mode: count the frame, and tune the queue at the end of the window.
+    void OnFramePushed();
 };
 
 class Allocator {
 public:
+    // The host buffers are aligned to alignment, see HostBuffer for is_huge_page.
+    Allocator(uint32_t alignment = 64, bool is_huge_page = false): pool_(alignment, is_huge_page), queue_bytes_(0) {}
     ~Allocator();
-    BlockingQueuePair *CreateBlockingQueue(std::vector<int> &shape, DataType type);
+    // depth <= 0: use the default depth.
+    // is_auto_depth: start from depth, and tune it during warm-up, see TuneBlockingQueue.
+    BlockingQueuePair *CreateBlockingQueue(std::vector<int> &shape, DataType type,
+                                           int depth = 0, bool is_auto_depth = false);
+    // Create a branch of the broadcast edge, see BlockingQueuePair::branches.
+    BlockingQueuePair *CreateBranchQueue(BlockingQueuePair *source);
+    // Call it before the queue is connected to the nodes.
+    void SetOverflowPolicy(BlockingQueuePair *bqp, OverflowPolicy policy);
+    // Make it a delay edge, one slot filled with value is put into full with id -1.
+    // Call it before the queue is connected to the nodes.
+    void SetDelay(BlockingQueuePair *bqp, float value);
+    // Grow or shrink the free pool of the queue according to the statistics of the window.
+    void TuneBlockingQueue(BlockingQueuePair *bqp);
     Tensor *CreateTensor(std::vector<int> &shape, DataType type, void *data);
+    // Read-only, on the file mapped by MappedBuffer.
+    Tensor *CreateMappedTensor(const std::string &path, uint64_t offset, std::vector<int> &shape,
+                               DataType type, MapPrefetch prefetch);
+    // A view on the memory of parent, see Tensor::BindView.
+    Tensor *CreateView(Tensor *parent, std::vector<int> &shape, std::vector<int> &strides, uint32_t offset);
+    // Delete the tensor created above, and its buffer goes back to the pool.
+    void ReleaseTensor(Tensor *t);
+    // A plain buffer for tensors to be placed in by offset, see MemoryPlanner.
+    Buffer *CreateArena(uint32_t size);
+    // The arena goes back to the pool, release the tensors placed in it first.
+    void ReleaseArena(Buffer *buffer);
 
     void PrintInfo();
+    inline MemoryStats memory_stats() { return pool_.stats(); }
+    inline void TrimMemory(uint64_t max_bytes) { pool_.Trim(max_bytes); }
     void ExitAllBlockingQueue();
+    void GetBlockingQueues(std::vector<BlockingQueuePair *> *queues);
 
 private:
     Buffer *CreateBuffer(MemoryType type, uint32_t size);
+    Tensor *CreateQueueSlot(std::vector<int> &shape, DataType type);
+    void ReleaseQueueSlot(Tensor *t);
 
     std::vector<BlockingQueuePair *> bq_pairs_; // 用于节点间数据交互
     std::vector<Tensor *> tensors_; // TODO: 添加Itensor与tensor映射，可通过Itensor找回tensor。
     std::vector<Buffer *> buffers_;
+    std::vector<Buffer *> mapped_buffers_; // Not pooled, unmapped when released.
+    BufferPool pool_; // The buffers are taken from it and go back to it.
+    uint32_t queue_bytes_; // Memory held by the slots of the BlockingQueuePairs.
+    std::mutex mutex_;
 };
 
 }  // end of namespace ecas.
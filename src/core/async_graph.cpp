@@ -13,24 +13,32 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <set>
+#include <algorithm>
 
 #include "util/logger.hpp"
 
 namespace ecas {
 
-AsyncGraph::AsyncGraph(const std::string &name, ExecutionMode mode, int num_thread, Allocator *allocator) {
+AsyncGraph::AsyncGraph(const std::string &name, SessionConfig &config, Allocator *allocator) {
     name_ = name;
-    mode_ = mode;
-    num_thread_ = num_thread;
-
-    name_ = "noname";
-    num_thread_ = 1;
+    mode_ = config.mode;
+    num_thread_ = config.num_thread;
+    // Only the nodes of a group share a thread in GROUP_THREAD, elsewhere a chain
+    // keeps its queues to be pipelined by the workers.
+    fuse_chains_ = config.fuse_chains && config.policy == GROUP_THREAD && config.mode != SERIAL;
+    fused_names_.clear();
     nodes_.clear();
 
-    input_node_ = nullptr;
-    output_node_ = nullptr;
+    usr_ = nullptr;
 
     allocator_ = allocator;
+    profile_path_ = config.profile_path;
+    num_async_requests_ = 0;
+    is_stream_pulling_ = false;
+
+    scheduler_.SetPolicy(config.policy, num_thread_);
+    scheduler_.SetGroupAttrs(config.group_attrs);
 }
 
 AsyncGraph::~AsyncGraph() {
@@ -44,20 +52,119 @@ AsyncGraph::~AsyncGraph() {
 void AsyncGraph::CreateNode(const std::string &name, Task &&task, 
                             std::vector<std::vector<int>> &&input_dims,
                             std::vector<std::vector<int>> &&output_dims,
-                            int group_id) {
+                            int group_id, int num_replica) {
     Node *n = new NormalNode(name, std::forward<Task>(task), input_dims, output_dims);
+    n->SetNumReplica(num_replica);
 
     scheduler_.MarkGroupId(n, group_id);
     nodes_.insert(std::make_pair(name, n));
 }
 
-void AsyncGraph::CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation) {
-
-    CompositeNode *node = new CompositeNode(name, std::forward<std::vector<std::vector<std::string>>>(relation));
+void AsyncGraph::CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation,
+                            int group_id) {
+    if (nodes_.count(name))
+        ECAS_LOGE("AsyncGraph::CreateNode -> %s already exists.\n", name.c_str());
+    CompositeNode *node = new CompositeNode(name, std::forward<std::vector<std::vector<std::string>>>(relation),
+                                            nodes_, allocator_);
+    // The inner nodes are owned and scheduled by the composite node.
+    std::vector<Node *> &inners = node->inner_nodes();
+    for (int i = 0; i < inners.size(); i++) {
+        scheduler_.UnmarkGroupId(inners[i]);
+        nodes_.erase(inners[i]->name());
+    }
+    scheduler_.MarkGroupId(node, group_id);
     nodes_.insert(std::make_pair(name, node));
 }
 
+void AsyncGraph::FuseChains(std::vector<std::vector<std::string>> &relation) {
+    // Look at the edges first, Topology::Build strips the attributes in its input.
+    Topology topo;
+    std::vector<std::vector<std::string>> temp = relation;
+    topo.Build(nodes_, std::move(temp));
+
+    // <a, b>: a -> b can be fused, which is the only output of a and the only input of b.
+    std::map<Node *, Node *> next;
+    std::set<Node *> has_prev;
+    for (std::map<std::string, Node *>::iterator iter = nodes_.begin(); iter != nodes_.end(); iter++) {
+        Node *a = iter->second;
+        std::vector<Node *> *outs = topo.GetOutputs(a);
+        if (outs == nullptr || outs->size() != 1 || a->output_dims().size() != 1)
+            continue;
+        Node *b = (*outs)[0];
+        std::vector<Node *> *ins = topo.GetInputs(b);
+        if (ins->size() != 1 || b->input_dims().size() != 1)
+            continue;
+        if (a->group_id() != b->group_id() || a->num_replica() > 1 || b->num_replica() > 1)
+            continue;
+        // The queue is kept if it is configured.
+        EdgeAttr attr = topo.GetEdgeAttr(a->name(), b->name());
+        if (attr.depth > 0 || attr.is_auto_depth || attr.overflow != OVERFLOW_BLOCK || attr.is_delay)
+            continue;
+        next[a] = b;
+        has_prev.insert(b);
+    }
+
+    // Each chain starts from a node without a fused front node.
+    std::map<std::string, std::string> &fused_names = fused_names_;
+    for (std::map<Node *, Node *>::iterator iter = next.begin(); iter != next.end(); iter++) {
+        if (has_prev.count(iter->first))
+            continue;
+        std::vector<Node *> nodes;
+        for (Node *n = iter->first; n != nullptr; ) {
+            nodes.push_back(n);
+            std::map<Node *, Node *>::iterator it = next.find(n);
+            n = it == next.end() ? nullptr : it->second;
+        }
+        // The graph needs distinct input and output nodes, leave the last one out.
+        if (topo.NumForwardInputs(nodes.front()) == 0 && topo.NumForwardOutputs(nodes.back()) == 0)
+            nodes.pop_back();
+        if (nodes.size() < 2)
+            continue;
+        std::vector<std::string> chain;
+        std::string name;
+        for (int i = 0; i < nodes.size(); i++) {
+            chain.push_back(nodes[i]->name());
+            name += (name.empty() ? "" : "+") + nodes[i]->name();
+        }
+        for (int i = 0; i < chain.size(); i++)
+            fused_names[chain[i]] = name;
+        int group_id = nodes.front()->group_id();
+        ECAS_LOGI("AsyncGraph::FuseChains -> %s.\n", name.c_str());
+        CreateNode(name, {chain}, group_id);
+    }
+    if (fused_names.empty())
+        return;
+
+    // Rewrite relation edge by edge, the attributes stay with the rear item.
+    std::vector<std::vector<std::string>> fused;
+    for (int i = 0; i < relation.size(); i++) {
+        std::vector<std::string> names(relation[i].size());
+        std::vector<std::string> items(relation[i].size());
+        for (int j = 0; j < relation[i].size(); j++) {
+            size_t pos = relation[i][j].find('[');
+            names[j] = relation[i][j].substr(0, pos);
+            std::string attr = pos == std::string::npos ? "" : relation[i][j].substr(pos);
+            std::map<std::string, std::string>::iterator it = fused_names.find(names[j]);
+            items[j] = (it == fused_names.end() ? names[j] : it->second) + attr;
+        }
+        if (items.size() == 1)
+            fused.push_back(items);
+        for (int j = 1; j < items.size(); j++) {
+            std::map<std::string, std::string>::iterator front = fused_names.find(names[j-1]);
+            std::map<std::string, std::string>::iterator rear = fused_names.find(names[j]);
+            if (front != fused_names.end() && rear != fused_names.end() && front->second == rear->second)
+                continue;
+            // The attributes of the front item belong to the edge before it, except the input.
+            std::string front_item = Topology::IsGraphPort(names[j-1], "input") ? items[j-1] : items[j-1].substr(0, items[j-1].find('['));
+            fused.push_back({front_item, items[j]});
+        }
+    }
+    relation.swap(fused);
+}
+
 void AsyncGraph::SetupInteractTensors() {
+    // <producer, source pair of its broadcast edge>
+    std::map<Node *, BlockingQueuePair *> broadcasts;
     for (int i = 0; i < graph_nodes_.size(); i++) {
         Node *n = graph_nodes_[i];
         std::vector<std::vector<int>> input_dims = n->input_dims();
@@ -69,9 +176,9 @@ void AsyncGraph::SetupInteractTensors() {
             continue;
         }
 
-        // The number of input shapes and input nodes should be the same.
-        if (input_nodes->size() != input_dims.size())
-            ECAS_LOGE("SetupInteractTensors -> output_nodes->size() != output_dims.size(): %d vs %d.\n",
+        // The ports left by the input nodes are the graph inputs.
+        if (input_nodes->size() > input_dims.size())
+            ECAS_LOGE("SetupInteractTensors -> input_nodes->size() > input_dims.size(): %d vs %d.\n",
                       input_nodes->size(), input_dims.size());
 
         // Check each of input nodes.
@@ -102,9 +209,47 @@ void AsyncGraph::SetupInteractTensors() {
                           (node %s to %s).\n", n->name().c_str(), in_node->name().c_str());
             }
             // Check passed and allocate BlockingQueuePair.
+            // In SERIAL mode, the tensors are passed directly by the SerialPlan.
+            if (mode_ == SERIAL)
+                continue;
             std::vector<int> tensor_shapes;
             tensor_shapes.assign(input_dims[si].begin() + 1, input_dims[si].end());
-            BlockingQueuePair *bqp = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)input_dims[si][0]);
+            EdgeAttr attr = topo_.GetEdgeAttr(in_node->name(), n->name());
+            // One output for several nodes: broadcast, the tensor is written once and shared by
+            // all of them. The attributes of the first edge are used for the shared slots.
+            if (need_match_dims.size() == 1 && in_node->output_nodes()->size() > 1) {
+                if (attr.is_delay) {
+                    ECAS_LOGE("SetupInteractTensors -> The delay edge %s -> %s can not be a broadcast.\n",
+                              in_node->name().c_str(), n->name().c_str());
+                }
+                std::map<Node *, BlockingQueuePair *>::iterator iter = broadcasts.find(in_node);
+                BlockingQueuePair *source;
+                if (iter != broadcasts.end()) {
+                    source = iter->second;
+                }
+                else {
+                    source = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)input_dims[si][0],
+                                                             attr.depth, attr.is_auto_depth);
+                    if (attr.overflow != OVERFLOW_BLOCK) {
+                        ECAS_LOGW("SetupInteractTensors -> Overflow policy is not supported by the broadcast edge of %s.\n",
+                                  in_node->name().c_str());
+                    }
+                    source->front_name = in_node->name();
+                    source->rear_name = "broadcast";
+                    in_node->AppendOutputs(source);
+                    broadcasts[in_node] = source;
+                }
+                BlockingQueuePair *branch = allocator_->CreateBranchQueue(source);
+                branch->front_name = in_node->name();
+                branch->rear_name = n->name();
+                n->AppendInputs(branch);
+                continue;
+            }
+            BlockingQueuePair *bqp = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)input_dims[si][0],
+                                                                     attr.depth, attr.is_auto_depth);
+            allocator_->SetOverflowPolicy(bqp, attr.overflow);
+            if (attr.is_delay)
+                allocator_->SetDelay(bqp, attr.delay_value);
             bqp->front_name = in_node->name();
             bqp->rear_name = n->name();
             in_node->AppendOutputs(bqp);
@@ -113,27 +258,160 @@ void AsyncGraph::SetupInteractTensors() {
     }
 }
 
-void AsyncGraph::SetupIoTensors() {
-    if (input_node_ == nullptr || output_node_ == nullptr)
-        ECAS_LOGE("SetupIoTensors -> Both input and output nodes must exist.\n");
-    if (input_node_->input_dims().size() != 1 || output_node_->output_dims().size() != 1)
-        ECAS_LOGE("SetupIoTensors -> Input node has one input, output node has one output.\n");
+void AsyncGraph::SetupGraphPorts() {
+    input_ports_.clear();
+    output_ports_.clear();
+    for (std::map<std::string, Node*>::iterator iter = nodes_.begin(); iter != nodes_.end(); iter++) {
+        Node *n = iter->second;
+        std::vector<Node *> *ins = n->input_nodes();
+        std::vector<Node *> *outs = n->output_nodes();
+        // Independent, not included in the graph.
+        if (ins == nullptr && outs == nullptr)
+            continue;
+        // The ports after the ones of the nodes in relation, and a broadcast output takes one port.
+        int num_in = ins == nullptr ? 0 : ins->size();
+        int num_out = outs == nullptr ? 0 : (n->output_dims().size() == 1 ? 1 : outs->size());
+        if (num_in > n->input_dims().size() || num_out > n->output_dims().size())
+            ECAS_LOGE("BuildGraph -> %s has more nodes than ports in relation.\n", n->name().c_str());
+        for (int i = num_in; i < n->input_dims().size(); i++) {
+            GraphPort port = {"", n, i, nullptr, -1, nullptr, false};
+            input_ports_.push_back(port);
+        }
+        for (int i = num_out; i < n->output_dims().size(); i++) {
+            GraphPort port = {"", n, i, nullptr, -1, nullptr, false};
+            output_ports_.push_back(port);
+        }
+    }
+    if (input_ports_.empty() || output_ports_.empty())
+        ECAS_LOGE("BuildGraph -> The graph needs at least one input port and one output port.\n");
+    NamePorts(input_ports_, topo_.graph_inputs(), "input");
+    NamePorts(output_ports_, topo_.graph_outputs(), "output");
+}
+
+void AsyncGraph::NamePorts(std::vector<GraphPort> &ports, std::vector<std::pair<std::string, std::string>> &declared,
+                           const std::string &prefix) {
+    // The ones named in relation come first, each takes the first unnamed port of its node.
+    std::vector<GraphPort> named;
+    for (int i = 0; i < declared.size(); i++) {
+        for (int j = 0; j < named.size(); j++) {
+            if (named[j].name == declared[i].first)
+                ECAS_LOGE("BuildGraph -> %s is declared more than once.\n", declared[i].first.c_str());
+        }
+        int pi = 0;
+        for (; pi < ports.size(); pi++) {
+            if (ports[pi].name.empty() && ports[pi].node->name() == declared[i].second)
+                break;
+        }
+        if (pi == ports.size())
+            ECAS_LOGE("BuildGraph -> %s has no open port for %s.\n", declared[i].second.c_str(), declared[i].first.c_str());
+        ports[pi].name = declared[i].first;
+        named.push_back(ports[pi]);
+    }
+    std::map<Node *, int> num_unnamed;
+    for (int i = 0; i < ports.size(); i++) {
+        if (!ports[i].name.empty())
+            continue;
+        if (ports.size() == 1) {
+            ports[i].name = prefix;
+        }
+        else {
+            int k = num_unnamed[ports[i].node]++;
+            ports[i].name = prefix + ":" + ports[i].node->name() + (k > 0 ? "." + std::to_string(k) : "");
+        }
+        named.push_back(ports[i]);
+    }
+    ports.swap(named);
+}
 
+AsyncGraph::GraphPort *AsyncGraph::FindPort(std::vector<GraphPort> &ports, const std::string &prefix,
+                                            const std::string &name) {
+    // With or without the prefix, like "input:video" or "video".
+    for (int i = 0; i < ports.size(); i++) {
+        if (ports[i].name == name || ports[i].name == prefix + ":" + name)
+            return &ports[i];
+    }
+    ECAS_LOGE("AsyncGraph::FindPort -> Can not find the graph port %s.\n", name.c_str());
+    return nullptr;
+}
+
+void AsyncGraph::SetupIoTensors() {
     std::vector<int> tensor_shapes;
     BlockingQueuePair *bqp;
+    EdgeAttr attr;
+
+    // The ports of a node are appended in order, after the ones of the nodes in relation.
+    for (int i = 0; i < input_ports_.size(); i++) {
+        GraphPort &port = input_ports_[i];
+        // Skip data type saved in shape[0].
+        std::vector<int> &input_dims = port.node->input_dims()[port.port];
+        tensor_shapes.assign(input_dims.begin() + 1, input_dims.end());
+        attr = topo_.GetEdgeAttr(port.name, port.node->name());
+        bqp = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)input_dims[0],
+                                              attr.depth, attr.is_auto_depth);
+        allocator_->SetOverflowPolicy(bqp, attr.overflow);
+        // The graph io queues can be accessed by several user threads.
+        bqp->free.SetMultiConsumer(true);
+        bqp->full.SetMultiProducer(true);
+        bqp->front_name = port.name;
+        bqp->rear_name = port.node->name();
+        port.node->AppendInputs(bqp);
+        port.queue = bqp;
+    }
+
+    for (int i = 0; i < output_ports_.size(); i++) {
+        GraphPort &port = output_ports_[i];
+        std::vector<int> &output_dims = port.node->output_dims()[port.port];
+        tensor_shapes.assign(output_dims.begin() + 1, output_dims.end());
+        attr = topo_.GetEdgeAttr(port.node->name(), port.name);
+        bqp = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)output_dims[0],
+                                              attr.depth, attr.is_auto_depth);
+        allocator_->SetOverflowPolicy(bqp, attr.overflow);
+        bqp->full.SetMultiConsumer(true);
+        bqp->free.SetMultiProducer(true);
+        // GraphFeedAsync takes its result from the first output.
+        if (i == 0)
+            bqp->deliver = [this](Tensor *t) -> bool { return DeliverResult(t); };
+        bqp->front_name = port.node->name();
+        bqp->rear_name = port.name;
+        port.node->AppendOutputs(bqp);
+        port.queue = bqp;
+    }
+}
 
-    // Skip data type saved in shape[0].
-    tensor_shapes.assign(input_node_->input_dims()[0].begin() + 1, input_node_->input_dims()[0].end());
-    bqp = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)input_node_->input_dims()[0][0]);
-    bqp->front_name = "input";
-    bqp->rear_name = input_node_->name();
-    input_node_->AppendInputs(bqp);
+void AsyncGraph::SetupSerialPlan() {
+    // Nodes with neither input nor output are not included in the graph.
+    std::vector<Node *> nodes;
+    for (int i = 0; i < graph_nodes_.size(); i++) {
+        if (graph_nodes_[i]->input_nodes() != nullptr || graph_nodes_[i]->output_nodes() != nullptr)
+            nodes.push_back(graph_nodes_[i]);
+    }
+    scheduler_.BuildSerialPlan(nodes, allocator_, &topo_);
 
-    tensor_shapes.assign(output_node_->output_dims()[0].begin() + 1, output_node_->output_dims()[0].end());
-    bqp = allocator_->CreateBlockingQueue(tensor_shapes, (DataType)output_node_->output_dims()[0][0]);
-    bqp->front_name = output_node_->name();
-    bqp->rear_name = "output";
-    output_node_->AppendOutputs(bqp);
+    SerialPlan &plan = scheduler_.serial_plan();
+    if (plan.num_inputs() != input_ports_.size() || plan.num_outputs() != output_ports_.size()) {
+        ECAS_LOGE("SetupSerialPlan -> io mismatch: (%d, %d) vs (%d, %d).\n", plan.num_inputs(), plan.num_outputs(),
+                  (int)input_ports_.size(), (int)output_ports_.size());
+    }
+    // Holds the fed input / the result of the latest Feed.
+    std::vector<int> tensor_shapes;
+    for (int i = 0; i < input_ports_.size(); i++) {
+        GraphPort &port = input_ports_[i];
+        port.plan_index = plan.FindInput(port.node, port.port);
+        if (port.plan_index < 0)
+            ECAS_LOGE("SetupSerialPlan -> %s is not an input of the plan.\n", port.name.c_str());
+        std::vector<int> &dims = port.node->input_dims()[port.port];
+        tensor_shapes.assign(dims.begin() + 1, dims.end());
+        port.serial = allocator_->CreateTensor(tensor_shapes, (DataType)dims[0], nullptr);
+    }
+    for (int i = 0; i < output_ports_.size(); i++) {
+        GraphPort &port = output_ports_[i];
+        port.plan_index = plan.FindOutput(port.node, port.port);
+        if (port.plan_index < 0)
+            ECAS_LOGE("SetupSerialPlan -> %s is not an output of the plan.\n", port.name.c_str());
+        std::vector<int> &dims = port.node->output_dims()[port.port];
+        tensor_shapes.assign(dims.begin() + 1, dims.end());
+        port.serial = allocator_->CreateTensor(tensor_shapes, (DataType)dims[0], nullptr);
+    }
 }
 
 void AsyncGraph::ReorderTensors() {
@@ -144,6 +422,8 @@ void AsyncGraph::ReorderTensors() {
 }
 
 void AsyncGraph::BuildGraph(std::vector<std::vector<std::string>> &&relation) {
+    if (fuse_chains_)
+        FuseChains(relation);
     // Build topology
     topo_.Build(nodes_, std::forward<std::vector<std::vector<std::string>>>(relation));
     // Specify inputs and outputs for each node according to the constructed topology.
@@ -155,26 +435,9 @@ void AsyncGraph::BuildGraph(std::vector<std::vector<std::string>> &&relation) {
         iter->second->SetOutputNodes(outputs);
     }
 
-    // Find the graph IO nodes according to the number of inputs and outputs.
-    // Input node of the graph: no input.
-    // Output node of the graph: no output.
-    // Only one input node and one output node are allowed
+    // The graph io: the ports not connected by relation.
     // Nodes with neither input nor output are not included in the graph.
-    for(iter = nodes_.begin(); iter != nodes_.end(); iter++) {
-        if (iter->second->input_nodes() == nullptr && iter->second->output_nodes() == nullptr) {
-            // independent, not included in the graph
-        }
-        else if (iter->second->input_nodes() == nullptr) {
-            if (input_node_ != nullptr) 
-                ECAS_LOGE("BuildGraph -> Only one input node is allowed.\n");
-            input_node_ = iter->second;
-        }
-        else if (iter->second->output_nodes() == nullptr) {
-            if (output_node_ != nullptr) 
-                ECAS_LOGE("BuildGraph -> Only one output node is allowed.\n");
-            output_node_ = iter->second;
-        }
-    }
+    SetupGraphPorts();
 
     // Group nodes.
     scheduler_.UpdateGroups();
@@ -182,8 +445,13 @@ void AsyncGraph::BuildGraph(std::vector<std::vector<std::string>> &&relation) {
 
     // Check shape && allocate memory && reorder
     SetupInteractTensors();
-    SetupIoTensors();
-    ReorderTensors();
+    if (mode_ == SERIAL) {
+        SetupSerialPlan();
+    }
+    else {
+        SetupIoTensors();
+        ReorderTensors();
+    }
     ECAS_LOGI("Finish AsyncGraph::BuildGraph.\n");
 }
 
@@ -196,8 +464,12 @@ void AsyncGraph::BuildGraph(std::vector<std::vector<std::string>> &&relation) {
 void AsyncGraph::ShowInfo() {
     ECAS_LOGS("\n>>>>>>>>> AsyncGraph ShowInfo >>>>>>>>>\n");
     ECAS_LOGS("AsyncGraph: %s.\n", name_.c_str());
-    ECAS_LOGS("Input node: %s.\n", input_node_->name().c_str());
-    ECAS_LOGS("Output node: %s.\n", output_node_->name().c_str());
+    for (int i = 0; i < input_ports_.size(); i++)
+        ECAS_LOGS("Input port: %s -> %s (%d).\n", input_ports_[i].name.c_str(),
+                  input_ports_[i].node->name().c_str(), input_ports_[i].port);
+    for (int i = 0; i < output_ports_.size(); i++)
+        ECAS_LOGS("Output port: %s (%d) -> %s.\n", output_ports_[i].node->name().c_str(),
+                  output_ports_[i].port, output_ports_[i].name.c_str());
 
     std::map<std::string, Node*>::iterator iter;
     for(iter = nodes_.begin(); iter != nodes_.end(); iter++) {
@@ -274,49 +546,302 @@ void AsyncGraph::ShowInfo() {
     }
 
     ECAS_LOGS("\n");
-    scheduler_.ShowGroups();
+    if (mode_ == SERIAL) {
+        scheduler_.serial_plan().Show();
+    }
+    else {
+        scheduler_.ShowGroups();
+        ECAS_LOGS("\n");
+        allocator_->PrintInfo();
+    }
     ECAS_LOGS(">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>\n\n");
 }
 
-void AsyncGraph::StartProfile() {
-    if (is_profiler_start_ == true)
+void AsyncGraph::Calibrate(void *usr, ITensor *sample, int num_iter) {
+    if (mode_ == SERIAL) {
+        ECAS_LOGW("AsyncGraph::Calibrate -> Nothing to group in SERIAL mode.\n");
         return;
-
-    is_profiler_start_ = true;
-    std::thread *t = new std::thread([this]() -> void {
-        while (is_profiler_start_ == true) {
-            allocator_->PrintInfo();
-            std::this_thread::sleep_for(std::chrono::seconds(3));
-        }
-    });
-}
-
-void AsyncGraph::EndProfile() {
-    is_profiler_start_ = false;
+    }
+    // The fused chains could not be split by the new groups.
+    if (!fused_names_.empty()) {
+        ECAS_LOGE("AsyncGraph::Calibrate -> The chains have been fused, set SessionConfig::fuse_chains to false to calibrate.\n");
+        return;
+    }
+    std::vector<Node *> nodes;
+    for (int i = 0; i < graph_nodes_.size(); i++) {
+        if (graph_nodes_[i]->input_nodes() != nullptr || graph_nodes_[i]->output_nodes() != nullptr)
+            nodes.push_back(graph_nodes_[i]);
+    }
+    scheduler_.AutoGroup(usr, nodes, allocator_, &topo_, sample, std::max(num_iter, 1));
+    scheduler_.GetGraphNodes(graph_nodes_);
 }
 
 void AsyncGraph::Start(void *usr) {
+    usr_ = usr;
+    // Nodes run in GraphFeed.
+    if (mode_ == SERIAL)
+        return;
     // Start all task threads.
+    if (!profile_path_.empty()) {
+        profiler_.Start(graph_nodes_, allocator_);
+        scheduler_.SetProfiler(&profiler_);
+    }
     scheduler_.TasksSpawn(usr);
-    // StartProfile();      
 }
 
 void AsyncGraph::Stop() {        
+    if (mode_ == SERIAL)
+        return;
     // Stop all task threads.
     scheduler_.TasksStop(allocator_);
     scheduler_.TasksJoin();
-    // EndProfile();
+    // Abandon the requests that will never be finished.
+    {
+        std::unique_lock<std::mutex> lock(async_mutex_);
+        async_requests_.clear();
+        num_async_requests_ = 0;
+    }
+    if (profiler_.is_started()) {
+        profiler_.Stop();
+        scheduler_.SetProfiler(nullptr);
+        profiler_.WriteChromeTrace(profile_path_);
+    }
     ECAS_LOGI("AsyncGraph::Stop().\n");
 }
 
 void AsyncGraph::Feed(ITensor *in) {
+    FeedPort(input_ports_[0], in);
+}
+
+void AsyncGraph::Feed(const std::string &port, ITensor *in) {
+    GraphPort *p = FindPort(input_ports_, "input", port);
+    if (p != nullptr)
+        FeedPort(*p, in);
+}
+
+void AsyncGraph::FeedPort(GraphPort &port, ITensor *in) {
     // ECAS_LOGI("AsyncGraph Running: %s, %d, %d.\n", name_.c_str(), p->mode, p->num_thread);
-    input_node_->input_queues()[0]->Enqueue(in);
-    // scheduler_.BfsExecute(input_node_, &in);
+    if (mode_ != SERIAL) {
+        port.queue->Enqueue(in);
+        return;
+    }
+    std::vector<ITensor *> inputs(input_ports_.size());
+    if (input_ports_.size() == 1) {
+        inputs[0] = in;
+    }
+    else {
+        // Run once all the ports have the frame of the same id, like the joins in the graph.
+        if (in != port.serial)
+            port.serial->CopyFrom(in);
+        port.is_fed = true;
+        for (int i = 0; i < input_ports_.size(); i++) {
+            if (!input_ports_[i].is_fed || input_ports_[i].serial->id() != in->id())
+                return;
+        }
+        for (int i = 0; i < input_ports_.size(); i++) {
+            input_ports_[i].is_fed = false;
+            inputs[input_ports_[i].plan_index] = input_ports_[i].serial;
+        }
+    }
+    std::vector<ITensor *> outputs(output_ports_.size());
+    for (int i = 0; i < output_ports_.size(); i++)
+        outputs[output_ports_[i].plan_index] = output_ports_[i].serial;
+    scheduler_.SerialExecute(usr_, inputs, outputs);
+    // Keep the latest result of each stream.
+    Tensor *serial_result = output_ports_[0].serial;
+    if (in->stream_id() >= 0) {
+        std::unique_lock<std::mutex> lock(stream_mutex_);
+        Tensor *&result = serial_stream_results_[in->stream_id()];
+        if (result == nullptr)
+            result = allocator_->CreateTensor(serial_result->shape(), serial_result->type(), nullptr);
+        serial_result->CopyTo(result);
+    }
 }
 
 void AsyncGraph::GetResult(ITensor *out) {
-    output_node_->output_queues()[0]->Dequeue(out);
+    GetPortResult(output_ports_[0], out);
+}
+
+void AsyncGraph::GetResult(const std::string &port, ITensor *out) {
+    GraphPort *p = FindPort(output_ports_, "output", port);
+    if (p != nullptr)
+        GetPortResult(*p, out);
+}
+
+void AsyncGraph::GetPortResult(GraphPort &port, ITensor *out) {
+    // In SERIAL mode, it is the result of the latest Feed.
+    if (mode_ == SERIAL) {
+        port.serial->CopyTo(out);
+        return;
+    }
+    port.queue->Dequeue(out);
+}
+
+void AsyncGraph::GetResult(ITensor *out, int stream_id) {
+    std::unique_lock<std::mutex> lock(stream_mutex_);
+    if (mode_ == SERIAL) {
+        std::map<int, Tensor *>::iterator iter = serial_stream_results_.find(stream_id);
+        if (iter == serial_stream_results_.end()) {
+            ECAS_LOGW("AsyncGraph::GetResult -> No result of stream %d.\n", stream_id);
+            return;
+        }
+        iter->second->CopyTo(out);
+        return;
+    }
+    // Only one thread pulls from the output queue at a time, and the results of the
+    // other streams are parked for them.
+    BlockingQueuePair *bqp = output_ports_[0].queue;
+    Tensor *t = nullptr;
+    while (t == nullptr) {
+        std::deque<Tensor *> &parked = stream_results_[stream_id];
+        if (!parked.empty()) {
+            t = parked.front();
+            parked.pop_front();
+            break;
+        }
+        if (is_stream_pulling_) {
+            stream_cond_.wait(lock);
+            continue;
+        }
+        is_stream_pulling_ = true;
+        lock.unlock();
+        Tensor *pulled;
+        bool is_ok = bqp->PopFull(&pulled);
+        lock.lock();
+        is_stream_pulling_ = false;
+        stream_cond_.notify_all();
+        if (!is_ok)
+            return;
+        if (pulled->stream_id() == stream_id)
+            t = pulled;
+        else
+            stream_results_[pulled->stream_id()].push_back(pulled);
+    }
+    lock.unlock();
+    t->CopyTo(out);
+    bqp->PushFree(t);
+}
+
+void AsyncGraph::DeclareNodeState(const std::string &name, uint32_t size) {
+    std::map<std::string, Node *>::iterator iter = nodes_.find(name);
+    if (iter == nodes_.end())
+        ECAS_LOGE("AsyncGraph::DeclareNodeState -> Can not find node %s.\n", name.c_str());
+    if (iter->second->num_replica() > 1) {
+        ECAS_LOGW("AsyncGraph::DeclareNodeState -> The replicas of %s are disabled for its state.\n", name.c_str());
+        iter->second->SetNumReplica(1);
+    }
+    iter->second->SetStateSize(size);
+}
+
+void AsyncGraph::FeedAsync(ITensor *in, std::function<void(ITensor *)> &&done) {
+    // Only the first output is delivered, the others would never be drained.
+    if (output_ports_.size() != 1) {
+        ECAS_LOGE("AsyncGraph::FeedAsync -> Only supports the graph with one output port, not %d.\n",
+                  (int)output_ports_.size());
+        return;
+    }
+    // The serial plan has only one set of tensors, the requests run one by one.
+    if (mode_ == SERIAL) {
+        std::unique_lock<std::mutex> lock(async_mutex_);
+        Feed(in);
+        done(output_ports_[0].serial);
+        return;
+    }
+    // Register before feeding, the result may arrive at once.
+    {
+        std::unique_lock<std::mutex> lock(async_mutex_);
+        if (async_requests_.count(in->id()))
+            ECAS_LOGE("AsyncGraph::FeedAsync -> Tensor id %d is still in flight.\n", in->id());
+        async_requests_[in->id()] = std::move(done);
+        num_async_requests_++;
+    }
+    Feed(in);
+}
+
+bool AsyncGraph::DeliverResult(Tensor *out) {
+    if (num_async_requests_ == 0)
+        return false;
+    std::function<void(ITensor *)> done;
+    {
+        std::unique_lock<std::mutex> lock(async_mutex_);
+        std::map<int, std::function<void(ITensor *)>>::iterator iter = async_requests_.find(out->id());
+        if (iter == async_requests_.end())
+            return false;
+        done = std::move(iter->second);
+        async_requests_.erase(iter);
+        num_async_requests_--;
+    }
+    done(out);
+    return true;
+}
+
+BlockingQueuePair *AsyncGraph::FindEdgeQueue(const std::string &front, const std::string &rear) {
+    // The edges of a fused chain are named by the composite nodes at both ends.
+    std::map<std::string, std::string>::iterator fit = fused_names_.find(front);
+    std::map<std::string, std::string>::iterator rit = fused_names_.find(rear);
+    std::string front_name = fit == fused_names_.end() ? front : fit->second;
+    std::string rear_name = rit == fused_names_.end() ? rear : rit->second;
+    if (fit != fused_names_.end() && rit != fused_names_.end() && front_name == rear_name) {
+        ECAS_LOGW("AsyncGraph -> The edge [%s, %s] is fused in %s, it has no queue.\n",
+                  front.c_str(), rear.c_str(), front_name.c_str());
+        return nullptr;
+    }
+    std::vector<BlockingQueuePair *> queues;
+    allocator_->GetBlockingQueues(&queues);
+    for (int i = 0; i < queues.size(); i++) {
+        if (queues[i]->front_name == front_name && queues[i]->rear_name == rear_name)
+            return queues[i];
+    }
+    ECAS_LOGW("AsyncGraph -> Can not find the edge [%s, %s].\n", front.c_str(), rear.c_str());
+    return nullptr;
+}
+
+int64_t AsyncGraph::GetDroppedFrames(const std::string &front, const std::string &rear) {
+    BlockingQueuePair *bqp = FindEdgeQueue(front, rear);
+    if (bqp == nullptr)
+        return 0;
+    return bqp->num_dropped;
+}
+
+int AsyncGraph::GetEdgeDepth(const std::string &front, const std::string &rear) {
+    BlockingQueuePair *bqp = FindEdgeQueue(front, rear);
+    if (bqp == nullptr)
+        return -1;
+    return bqp->depth;
+}
+
+ITensor *AsyncGraph::BorrowInput() {
+    if (mode_ == SERIAL)
+        return input_ports_[0].serial;
+    Tensor *t;
+    if (!input_ports_[0].queue->AcquireFree(&t))
+        return nullptr;
+    return t;
+}
+
+void AsyncGraph::SubmitInput(ITensor *in) {
+    if (mode_ == SERIAL) {
+        if (in != input_ports_[0].serial)
+            ECAS_LOGE("AsyncGraph::SubmitInput -> The tensor is not from BorrowInput.\n");
+        Feed(in);
+        return;
+    }
+    input_ports_[0].queue->PushFull((Tensor *)in);
+}
+
+ITensor *AsyncGraph::TakeResult() {
+    if (mode_ == SERIAL)
+        return output_ports_[0].serial;
+    Tensor *t;
+    if (!output_ports_[0].queue->PopFull(&t))
+        return nullptr;
+    return t;
+}
+
+void AsyncGraph::ReleaseResult(ITensor *out) {
+    if (mode_ == SERIAL)
+        return;
+    output_ports_[0].queue->PushFree((Tensor *)out);
 }
 
 } // ecas.
\ No newline at end of file
@@ -5,26 +5,32 @@
 #ifndef ECAS_CORE_ASYNC_GRAPH_HPP_
 #define ECAS_CORE_ASYNC_GRAPH_HPP_
 
+#include <deque>
+#include <condition_variable>
+
 #include "normal_node.hpp"
 #include "composite_node.hpp"
 #include "tensor.hpp"
 #include "topology.hpp"
 #include "scheduler.hpp"
+#include "profiler.hpp"
 
 namespace ecas {
 
 class AsyncGraph {
 public:
-    AsyncGraph(const std::string &name, ExecutionMode mode, int num_thread, Allocator *allocator);
+    AsyncGraph(const std::string &name, SessionConfig &config, Allocator *allocator);
     ~AsyncGraph();
 
     void CreateNode(const std::string &name, Task &&task, 
                     std::vector<std::vector<int>> &&in_shapes, 
                     std::vector<std::vector<int>> &&out_shapes,
-                    int group_id = 0);
-    void CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation);
+                    int group_id = 0, int num_replica = 1);
+    void CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation,
+                    int group_id);
     void BuildGraph(std::vector<std::vector<std::string>> &&relation);
     void ShowInfo();
+    void Calibrate(void *usr, ITensor *sample, int num_iter);
 
     void Start(void *usr);
     void Stop();
@@ -33,32 +39,88 @@ public:
     void Feed(ITensor *in);
     // Get the result after calling the Feed.
     void GetResult(ITensor *out);
+    // The next result of the stream, see Session::GraphFeed(in, stream_id).
+    void GetResult(ITensor *out, int stream_id);
+    // The graph ports by name, see Session::BuildGraph.
+    void Feed(const std::string &port, ITensor *in);
+    void GetResult(const std::string &port, ITensor *out);
+    void DeclareNodeState(const std::string &name, uint32_t size);
+
+    // done is called when the output with the id of in arrives.
+    void FeedAsync(ITensor *in, std::function<void(ITensor *)> &&done);
+    int64_t GetDroppedFrames(const std::string &front, const std::string &rear);
+    int GetEdgeDepth(const std::string &front, const std::string &rear);
+
+    // Zero-copy version of Feed / GetResult, see Session::GraphBorrowInput.
+    ITensor *BorrowInput();
+    void SubmitInput(ITensor *in);
+    ITensor *TakeResult();
+    void ReleaseResult(ITensor *out);
 
 private:
+    // An open port of a node, fed / read by the user.
+    struct GraphPort {
+        std::string name;
+        Node *node;
+        int port;
+        BlockingQueuePair *queue; // Not SERIAL mode.
+        // SERIAL mode: the index in the serial plan, and the fed input / the latest result.
+        int plan_index;
+        Tensor *serial;
+        bool is_fed;
+    };
+    // Collect the open ports of the nodes, and name them.
+    void SetupGraphPorts();
+    void NamePorts(std::vector<GraphPort> &ports, std::vector<std::pair<std::string, std::string>> &declared,
+                   const std::string &prefix);
+    // nullptr if not found.
+    GraphPort *FindPort(std::vector<GraphPort> &ports, const std::string &prefix, const std::string &name);
+    void FeedPort(GraphPort &port, ITensor *in);
+    void GetPortResult(GraphPort &port, ITensor *out);
     // Check whether the shapes match and create tensors for node interaction.
     void SetupInteractTensors();
+    // Replace the chains in relation by composite nodes, see SessionConfig::fuse_chains.
+    void FuseChains(std::vector<std::vector<std::string>> &relation);
+    // Looks up an edge by the node names given in BuildGraph, nullptr if not found.
+    BlockingQueuePair *FindEdgeQueue(const std::string &front, const std::string &rear);
     void SetupIoTensors();
+    void SetupSerialPlan();
     void ReorderTensors();
-    //
-    void StartProfile();
-    void EndProfile();
+    // Hands the output over to its async request if any.
+    bool DeliverResult(Tensor *out);
 
 private:
     std::string name_;
     ExecutionMode mode_;
     int num_thread_;
+    bool fuse_chains_;
+    std::map<std::string, std::string> fused_names_; // Node name -> its composite node name.
 
     std::map<std::string, Node*> nodes_; // 包含普通节点和组合节点
-    Node *input_node_;
-    Node *output_node_;
     std::vector<Node *> graph_nodes_; // 参与组建图的节点
+    // The first ones are used by the functions without a port name.
+    std::vector<GraphPort> input_ports_;
+    std::vector<GraphPort> output_ports_;
 
     Topology topo_;
     void *usr_;
     Scheduler scheduler_;
     Allocator *allocator_;
 
-    bool is_profiler_start_;
+    // <tensor id, callback> of GraphFeedAsync.
+    std::map<int, std::function<void(ITensor *)>> async_requests_;
+    std::atomic<int> num_async_requests_;
+    std::mutex async_mutex_;
+
+    // The results pulled out for the other streams.
+    std::map<int, std::deque<Tensor *>> stream_results_;
+    std::map<int, Tensor *> serial_stream_results_;
+    bool is_stream_pulling_;
+    std::mutex stream_mutex_;
+    std::condition_variable stream_cond_;
+
+    std::string profile_path_;
+    Profiler profiler_;
 };
 
 }  // end of namespace ecas.
@@ -5,6 +5,7 @@
 #ifndef ECAS_CORE_BUFFER_HPP_
 #define ECAS_CORE_BUFFER_HPP_
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,7 @@ public:
     virtual ~Buffer() {};
 
     virtual void *data() = 0;
+    virtual uint32_t size() = 0;
 };
 
 }  // end of namespace ecas.
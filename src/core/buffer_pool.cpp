@@ -0,0 +1,87 @@
+/*!
+* \brief BufferPool.
+*/
+
+#include "buffer_pool.hpp"
+
+#include <string.h>
+
+#include "backend/buffer/host_buffer.hpp"
+#include "util/logger.hpp"
+
+namespace ecas {
+
+#define ECAS_POOL_MIN_CLASS 64
+
+BufferPool::BufferPool(uint32_t alignment, bool is_huge_page) {
+    alignment_ = alignment;
+    is_huge_page_ = is_huge_page;
+    stats_ = MemoryStats();
+}
+
+BufferPool::~BufferPool() {
+    Trim(0);
+}
+
+uint32_t BufferPool::ClassSize(uint32_t size) {
+    if (size <= ECAS_POOL_MIN_CLASS)
+        return ECAS_POOL_MIN_CLASS;
+    // pow2 < size <= pow2 * 2, split into 4 steps.
+    uint64_t pow2 = ECAS_POOL_MIN_CLASS;
+    while (pow2 * 2 < size)
+        pow2 *= 2;
+    uint64_t step = pow2 / 4;
+    return (uint32_t)((size + step - 1) / step * step);
+}
+
+Buffer *BufferPool::Acquire(uint32_t size) {
+    uint32_t class_size = ClassSize(size);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::map<uint32_t, std::vector<Buffer *>>::iterator iter = free_lists_.find(class_size);
+        if (iter != free_lists_.end() && !iter->second.empty()) {
+            Buffer *buffer = iter->second.back();
+            iter->second.pop_back();
+            stats_.hits++;
+            stats_.bytes_cached -= class_size;
+            stats_.bytes_in_use += class_size;
+            lock.unlock();
+            // The same as a new one.
+            memset(buffer->data(), 0, size);
+            return buffer;
+        }
+        stats_.misses++;
+        stats_.bytes_in_use += class_size;
+    }
+    return new HostBuffer(class_size, alignment_, is_huge_page_);
+}
+
+void BufferPool::Release(Buffer *buffer) {
+    uint32_t class_size = buffer->size();
+    if (class_size != ClassSize(class_size))
+        ECAS_LOGE("BufferPool::Release -> The buffer (%u bytes) is not from the pool.\n", class_size);
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_lists_[class_size].push_back(buffer);
+    stats_.bytes_cached += class_size;
+    stats_.bytes_in_use -= class_size;
+}
+
+void BufferPool::Trim(uint64_t max_bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::map<uint32_t, std::vector<Buffer *>>::reverse_iterator iter = free_lists_.rbegin();
+    for (; iter != free_lists_.rend() && stats_.bytes_cached > max_bytes; iter++) {
+        std::vector<Buffer *> &buffers = iter->second;
+        while (!buffers.empty() && stats_.bytes_cached > max_bytes) {
+            delete buffers.back();
+            buffers.pop_back();
+            stats_.bytes_cached -= iter->first;
+        }
+    }
+}
+
+MemoryStats BufferPool::stats() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+}  // end of namespace ecas.
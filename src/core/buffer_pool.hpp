@@ -0,0 +1,50 @@
+/*!
+* \brief BufferPool.
+*        按尺寸分级缓存释放的host buffer，供后续相近尺寸的申请复用，减少系统分配。
+*        每个2的幂区间分为4级，浪费不超过25%。
+*/
+
+#ifndef ECAS_CORE_BUFFER_POOL_HPP_
+#define ECAS_CORE_BUFFER_POOL_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#include "buffer.hpp"
+#include "ecas/ecas.hpp"
+
+namespace ecas {
+
+class BufferPool {
+public:
+    // See HostBuffer for alignment and is_huge_page.
+    BufferPool(uint32_t alignment = 64, bool is_huge_page = false);
+    ~BufferPool();
+
+    // A zeroed host buffer of at least size bytes, taken from the free list of its
+    // size class if any, otherwise newly allocated with the class size.
+    // The address is aligned as required by the constructor.
+    Buffer *Acquire(uint32_t size);
+    // Put it back to the free list of its class, it will be handed out again.
+    void Release(Buffer *buffer);
+    // Free the cached buffers, the largest first, until at most max_bytes are cached.
+    void Trim(uint64_t max_bytes = 0);
+    MemoryStats stats();
+
+    // The size actually allocated for size bytes.
+    static uint32_t ClassSize(uint32_t size);
+
+private:
+    uint32_t alignment_;
+    bool is_huge_page_;
+    std::mutex mutex_;
+    // <class size, cached buffers>
+    std::map<uint32_t, std::vector<Buffer *>> free_lists_;
+    MemoryStats stats_;
+};
+
+}  // end of namespace ecas.
+
+#endif // ECAS_CORE_BUFFER_POOL_HPP_
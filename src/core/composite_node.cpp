@@ -4,15 +4,51 @@
 
 #include "composite_node.hpp"
 
+#include <set>
+
+#include "util/logger.hpp"
+
 namespace ecas {
 
-CompositeNode::CompositeNode(const std::string &name, std::vector<std::vector<std::string>> &&relation) {
+CompositeNode::CompositeNode(const std::string &name, std::vector<std::vector<std::string>> &&relation,
+                             std::map<std::string, Node*> &nodes, Allocator *allocator) {
     name_ = name;
-}
+    // The edge attributes are stripped from relation, and they are meaningless without queues.
+    topo_.Build(nodes, std::forward<std::vector<std::vector<std::string>>>(relation));
 
-CompositeNode::~CompositeNode() {
+    std::set<std::string> names;
+    for (int i = 0; i < relation.size(); i++) {
+        for (int j = 0; j < relation[i].size(); j++) {
+            if (names.count(relation[i][j]))
+                continue;
+            names.insert(relation[i][j]);
+            Node *n = nodes[relation[i][j]];
+            n->SetInputNodes(topo_.GetInputs(n));
+            n->SetOutputNodes(topo_.GetOutputs(n));
+            inner_nodes_.push_back(n);
+        }
+    }
+    if (inner_nodes_.empty())
+        ECAS_LOGE("CompositeNode -> %s is empty.\n", name_.c_str());
 
+    plan_.Build(inner_nodes_, allocator, &topo_);
+    for (int i = 0; i < plan_.num_inputs(); i++)
+        input_dims_.push_back(plan_.input_dims(i));
+    for (int i = 0; i < plan_.num_outputs(); i++)
+        output_dims_.push_back(plan_.output_dims(i));
 }
 
+void CompositeNode::ResetStates() {
+    Node::ResetStates();
+    for (int i = 0; i < inner_nodes_.size(); i++)
+        inner_nodes_[i]->ResetStates();
+    plan_.ResetDelays();
+}
+
+CompositeNode::~CompositeNode() {
+    for (int i = 0; i < inner_nodes_.size(); i++)
+        delete inner_nodes_[i];
+    inner_nodes_.clear();
+}
 
-}  // end of namespace ecas.
\ No newline at end of file
+}  // end of namespace ecas.
@@ -1,5 +1,7 @@
 /*!
 * \brief Composit node.
+*        将一个子图编译为串行执行计划，在一个线程中按拓扑序依次执行内部节点。
+*        内部边的张量来自一块内部arena，不创建BlockingQueuePair，对外表现为单个节点。
 */
 
 #ifndef ECAS_CORE_COMPOSITE_NODE_HPP_
@@ -7,21 +9,34 @@
 
 #include <string>
 #include "node.hpp"
+#include "topology.hpp"
+#include "serial_plan.hpp"
 
 namespace ecas {
 
 class CompositeNode: public Node {
     
 public:
-    CompositeNode(const std::string &name, std::vector<std::vector<std::string>> &&relation);
+    // The nodes named in relation are taken from nodes, and owned by the composite node.
+    // The unconnected ports of the subgraph become the ports of the composite node,
+    // ordered by the execution order of their inner nodes.
+    CompositeNode(const std::string &name, std::vector<std::vector<std::string>> &&relation,
+                  std::map<std::string, Node*> &nodes, Allocator *allocator);
     ~CompositeNode();
 
-    virtual void Run(void *usr, std::vector<ITensor *> &input, std::vector<ITensor *> &output) { task_(usr, input, output); }
+    virtual void Run(void *usr, std::vector<ITensor *> &input, std::vector<ITensor *> &output) { plan_.Run(usr, input, output); }
+    // Also the inner nodes and the delay edges inside.
+    virtual void ResetStates();
+
+    inline std::vector<Node *> &inner_nodes() { return inner_nodes_; }
+    inline SerialPlan &plan() { return plan_; }
 
 private:
-    Task task_;
+    Topology topo_;
+    SerialPlan plan_;
+    std::vector<Node *> inner_nodes_;
 };
 
 }  // end of namespace ecas.
 
-#endif //ECAS_CORE_COMPOSITE_NODE_HPP_
\ No newline at end of file
+#endif //ECAS_CORE_COMPOSITE_NODE_HPP_
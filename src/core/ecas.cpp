@@ -34,8 +34,8 @@ struct SessionParams {
 Session::Session(const std::string &name, SessionConfig &config) {
     SessionParams *p = new SessionParams;
     p->executor = new OperatorExecutor();
-    p->allocator = new Allocator();
-    p->graph = new AsyncGraph(name, config.mode, config.num_thread, p->allocator);
+    p->allocator = new Allocator(config.memory_alignment, config.huge_pages);
+    p->graph = new AsyncGraph(name, config, p->allocator);
     
     params_ = (void *)p;
 }
@@ -56,6 +56,42 @@ ITensor *Session::CreateITensor(std::vector<int> &&shape, DataType type, void *d
     return t;
 }
 
+ITensor *Session::CreateMappedITensor(const std::string &path, uint64_t offset, std::vector<int> &&shape,
+                                      DataType type, MapPrefetch prefetch) {
+    SessionParams *p = (SessionParams *)params_;
+    return p->allocator->CreateMappedTensor(path, offset, shape, type, prefetch);
+}
+
+ITensor *Session::CreateViewITensor(ITensor *parent, std::vector<int> &&shape, std::vector<int> &&strides,
+                                    uint32_t offset) {
+    SessionParams *p = (SessionParams *)params_;
+    return p->allocator->CreateView((Tensor *)parent, shape, strides, offset);
+}
+
+ITensor *Session::SliceITensor(ITensor *parent, int axis, int start, int end) {
+    SessionParams *p = (SessionParams *)params_;
+    std::vector<int> shape = parent->shape();
+    if (axis < 0 || axis >= shape.size() || start < 0 || end > shape[axis] || start >= end)
+        ECAS_LOGE("Session::SliceITensor -> [%d, %d) is out of the axis %d.\n", start, end, axis);
+    shape[axis] = end - start;
+    return p->allocator->CreateView((Tensor *)parent, shape, parent->strides(), start * parent->strides()[axis]);
+}
+
+void Session::ReleaseITensor(ITensor *tensor) {
+    SessionParams *p = (SessionParams *)params_;
+    p->allocator->ReleaseTensor((Tensor *)tensor);
+}
+
+MemoryStats Session::GetMemoryStats() {
+    SessionParams *p = (SessionParams *)params_;
+    return p->allocator->memory_stats();
+}
+
+void Session::TrimMemory(uint64_t max_bytes) {
+    SessionParams *p = (SessionParams *)params_;
+    p->allocator->TrimMemory(max_bytes);
+}
+
 /////////////////////
 // Operator executor
 void *Session::CreateOp(std::string op_name, std::string op_params) {
@@ -74,17 +110,23 @@ void Session::OpRun(void *op_ptr, std::vector<Param> &params,
 void Session::CreateNode(const std::string &name, Task &&task, 
                          std::vector<std::vector<int>> &&input_dims, 
                          std::vector<std::vector<int>> &&output_dims, 
-                         int group_id) {
+                         int group_id, int num_replica) {
     SessionParams *p = (SessionParams *)params_;                        
     p->graph->CreateNode(name, std::forward<Task>(task), 
                          std::forward<std::vector<std::vector<int>>>(input_dims), 
                          std::forward<std::vector<std::vector<int>>>(output_dims), 
-                         group_id);
+                         group_id, num_replica);
+}
+
+void Session::CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation,
+                         int group_id) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->CreateNode(name, std::forward<std::vector<std::vector<std::string>>>(relation), group_id);
 }
 
-void Session::CreateNode(const std::string &name, std::vector<std::vector<std::string>> &&relation) {
+void Session::DeclareNodeState(const std::string &name, uint32_t size) {
     SessionParams *p = (SessionParams *)params_;
-    p->graph->CreateNode(name, std::forward<std::vector<std::vector<std::string>>>(relation));
+    p->graph->DeclareNodeState(name, size);
 }
 
 void Session::BuildGraph(std::vector<std::vector<std::string>> &&relation) {
@@ -92,6 +134,11 @@ void Session::BuildGraph(std::vector<std::vector<std::string>> &&relation) {
     p->graph->BuildGraph(std::forward<std::vector<std::vector<std::string>>>(relation));
 }
 
+void Session::GraphCalibrate(void *usr, ITensor *sample, int num_iter) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->Calibrate(usr, sample, num_iter);
+}
+
 void Session::ShowInfo() {
     SessionParams *p = (SessionParams *)params_;
     p->graph->ShowInfo();
@@ -117,6 +164,84 @@ void Session::GraphGetResult(ITensor *out) {
     p->graph->GetResult(out); 
 }
 
+void Session::GraphFeed(ITensor *in, int stream_id) {
+    GraphFeed(in, stream_id, in->priority());
+}
+
+void Session::GraphFeed(ITensor *in, int stream_id, int priority) {
+    SessionParams *p = (SessionParams *)params_;
+    // Only for this frame, the tensor is copied into the graph by Feed.
+    // Restore them for the next plain GraphFeed with the same tensor.
+    int prev_stream_id = in->stream_id();
+    int prev_priority = in->priority();
+    in->SetStreamId(stream_id);
+    in->SetPriority(priority);
+    p->graph->Feed(in);
+    in->SetStreamId(prev_stream_id);
+    in->SetPriority(prev_priority);
+}
+
+void Session::GraphGetResult(ITensor *out, int stream_id) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->GetResult(out, stream_id);
+}
+
+void Session::GraphFeed(const std::string &port, ITensor *in) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->Feed(port, in);
+}
+
+void Session::GraphGetResult(const std::string &port, ITensor *out) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->GetResult(port, out);
+}
+
+std::future<void> Session::GraphFeedAsync(ITensor *in, ITensor *out) {
+    SessionParams *p = (SessionParams *)params_;
+    std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    p->graph->FeedAsync(in, [promise, out](ITensor *result) -> void {
+        ((Tensor *)result)->CopyTo(out);
+        promise->set_value();
+    });
+    return future;
+}
+
+void Session::GraphFeedAsync(ITensor *in, std::function<void(ITensor *out)> &&done) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->FeedAsync(in, std::forward<std::function<void(ITensor *)>>(done));
+}
+
+int64_t Session::GraphGetDroppedFrames(const std::string &front, const std::string &rear) {
+    SessionParams *p = (SessionParams *)params_;
+    return p->graph->GetDroppedFrames(front, rear);
+}
+
+int Session::GraphGetEdgeDepth(const std::string &front, const std::string &rear) {
+    SessionParams *p = (SessionParams *)params_;
+    return p->graph->GetEdgeDepth(front, rear);
+}
+
+ITensor *Session::GraphBorrowInput() {
+    SessionParams *p = (SessionParams *)params_;
+    return p->graph->BorrowInput();
+}
+
+void Session::GraphSubmitInput(ITensor *in) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->SubmitInput(in);
+}
+
+ITensor *Session::GraphTakeResult() {
+    SessionParams *p = (SessionParams *)params_;
+    return p->graph->TakeResult();
+}
+
+void Session::GraphReleaseResult(ITensor *out) {
+    SessionParams *p = (SessionParams *)params_;
+    p->graph->ReleaseResult(out);
+}
+
 //////////////
 // UtilBox
 struct UtilBoxParams {
@@ -0,0 +1,66 @@
+/*!
+* \brief MemoryPlanner.
+*/
+
+#include "memory_planner.hpp"
+
+#include <algorithm>
+
+namespace ecas {
+
+MemoryPlanner::MemoryPlanner(uint32_t alignment) {
+    alignment_ = alignment;
+    planned_size_ = 0;
+    naive_size_ = 0;
+}
+
+int MemoryPlanner::AddBlock(uint32_t size, int first, int last) {
+    Block b;
+    b.size = (size + alignment_ - 1) / alignment_ * alignment_;
+    b.first = first;
+    b.last = last;
+    b.offset = 0;
+    blocks_.push_back(b);
+    return blocks_.size() - 1;
+}
+
+void MemoryPlanner::Plan() {
+    std::vector<int> order(blocks_.size());
+    for (int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return blocks_[a].size > blocks_[b].size;
+    });
+
+    planned_size_ = 0;
+    naive_size_ = 0;
+    std::vector<int> placed;
+    for (int i = 0; i < order.size(); i++) {
+        Block &b = blocks_[order[i]];
+        naive_size_ += b.size;
+
+        // The placed blocks alive at the same time, sorted by offset.
+        std::vector<int> conflicts;
+        for (int j = 0; j < placed.size(); j++) {
+            Block &p = blocks_[placed[j]];
+            if (p.first <= b.last && b.first <= p.last)
+                conflicts.push_back(placed[j]);
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [this](int x, int y) {
+            return blocks_[x].offset < blocks_[y].offset;
+        });
+        // Take the first gap that is large enough.
+        uint32_t offset = 0;
+        for (int j = 0; j < conflicts.size(); j++) {
+            Block &p = blocks_[conflicts[j]];
+            if (p.offset >= offset + b.size)
+                break;
+            offset = std::max(offset, p.offset + p.size);
+        }
+        b.offset = offset;
+        planned_size_ = std::max(planned_size_, offset + b.size);
+        placed.push_back(order[i]);
+    }
+}
+
+}  // end of namespace ecas.
@@ -0,0 +1,45 @@
+/*!
+* \brief MemoryPlanner.
+*        根据张量的生命周期，将生命周期不重叠的张量分配到同一块内存的相同区域。
+*        生命周期以执行步骤的序号表示，[first, last]闭区间。
+*/
+
+#ifndef ECAS_CORE_MEMORY_PLANNER_HPP_
+#define ECAS_CORE_MEMORY_PLANNER_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+namespace ecas {
+
+class MemoryPlanner {
+public:
+    MemoryPlanner(uint32_t alignment = 64);
+
+    // Returns the index of the block.
+    int AddBlock(uint32_t size, int first, int last);
+    // Greedy by size: the larger blocks are placed first, each at the lowest
+    // offset which does not overlap with the placed blocks alive at the same time.
+    void Plan();
+
+    inline uint32_t offset(int i) const { return blocks_[i].offset; }
+    inline uint32_t planned_size() const { return planned_size_; }
+    inline uint32_t naive_size() const { return naive_size_; }
+
+private:
+    struct Block {
+        uint32_t size;
+        int first;
+        int last;
+        uint32_t offset;
+    };
+
+    uint32_t alignment_;
+    std::vector<Block> blocks_;
+    uint32_t planned_size_;
+    uint32_t naive_size_;
+};
+
+}  // end of namespace ecas.
+
+#endif // ECAS_CORE_MEMORY_PLANNER_HPP_
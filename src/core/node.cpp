@@ -3,6 +3,10 @@
 */
 
 #include "node.hpp"
+
+#include <algorithm>
+
+#include "task_context.hpp"
 #include "util/logger.hpp"
 
 namespace ecas {
@@ -15,16 +19,16 @@ void Node::SwapQueueOrder(std::vector<BlockingQueuePair *> &queues, int i, int j
 }
 
 void Node::ReorderInputQueues() {
-    // Make the order of the input queues consistent with the order of the input nodes
+    // Make the order of the input queues consistent with the order of the input nodes,
+    // the graph input is behind them.
     if (input_nodes_ != nullptr) {
         for (int ni = 0; ni < input_nodes_->size(); ni++) {
             std::string target_name = (*input_nodes_)[ni]->name();
-            for (int qi = 0; qi < input_queues_.size(); qi++) {
+            for (int qi = ni; qi < input_queues_.size(); qi++) {
                 if (target_name == input_queues_[qi]->front_name) {
-                    if (ni == qi) 
-                        continue;
-                    else 
+                    if (ni != qi)
                         SwapQueueOrder(input_queues_, ni, qi);
+                    break;
                 }
             }
         }
@@ -32,83 +36,273 @@ void Node::ReorderInputQueues() {
 }
 
 void Node::ReorderOutputQueues() {
-    // Make the order of the output queues consistent with the order of the output nodes
+    // Make the order of the output queues consistent with the order of the output nodes,
+    // the graph output is behind them.
     if (output_nodes_ != nullptr) {
         for (int ni = 0; ni < output_nodes_->size(); ni++) {
             std::string target_name = (*output_nodes_)[ni]->name();
-            for (int qi = 0; qi < output_queues_.size(); qi++) {
+            for (int qi = ni; qi < output_queues_.size(); qi++) {
                 if (target_name == output_queues_[qi]->rear_name) {
-                    if (ni == qi)
-                        continue;
-                    else
+                    if (ni != qi)
                         SwapQueueOrder(output_queues_, ni, qi);
+                    break;
                 }
             }
         }
     }
 }
 
+void Node::AppendInputs(BlockingQueuePair *bq) {
+    bq->consumer = this;
+    // The replicas recycle the inputs at the same time.
+    if (num_replica_ > 1)
+        bq->free.SetMultiProducer(true);
+    if (bq->num_full == 0)
+        num_unready_++;
+    input_queues_.push_back(bq);
+}
+
+void Node::AppendOutputs(BlockingQueuePair *bq) {
+    bq->producer = this;
+    // A dropping edge never blocks the producer.
+    if (bq->overflow == OVERFLOW_BLOCK && bq->num_free == 0)
+        num_unready_++;
+    output_queues_.push_back(bq);
+}
+
+void Node::OnPortChanged(bool is_ready) {
+    // The updates of different ports may arrive out of order, so num_unready_ can
+    // touch 0 from both sides. The notified one will check again by CheckIoIsReady.
+    int num = is_ready ? --num_unready_ : ++num_unready_;
+    if (num == 0 && ready_notifier_)
+        ready_notifier_(this);
+}
+
 bool Node::CheckIoIsReady() {
-    bool is_ready = true;
     for (int i=0; i<input_queues_.size(); i++) {
-        if (input_queues_[i]->full.empty())
-            is_ready = false;
+        if (input_queues_[i]->num_full <= 0)
+            return false;
     }
     for (int i=0; i<output_queues_.size(); i++) {
-        if (output_queues_[i]->free.empty())
-            is_ready = false;
+        if (output_queues_[i]->overflow == OVERFLOW_BLOCK && output_queues_[i]->num_free <= 0)
+            return false;
+    }
+    return true;
+}
+
+void Node::Invoke(void *usr, std::vector<ITensor *> &input, std::vector<ITensor *> &output) {
+    int stream_id = -1;
+    if (!output.empty())
+        stream_id = output[0]->stream_id();
+    else if (!input.empty())
+        stream_id = input[0]->stream_id();
+    TaskScope scope(this, stream_id);
+    Run(usr, input, output);
+}
+
+void *Node::GetState(int stream_id) {
+    if (state_size_ == 0)
+        return nullptr;
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    std::map<int, std::vector<char>>::iterator iter = states_.find(stream_id);
+    if (iter == states_.end())
+        iter = states_.insert(std::make_pair(stream_id, std::vector<char>(state_size_, 0))).first;
+    return iter->second.data();
+}
+
+void Node::ResetStates() {
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    states_.clear();
+}
+
+bool Node::TryClaim() {
+    int num = num_running_.load();
+    while (num < num_replica_) {
+        if (num_running_.compare_exchange_weak(num, num + 1))
+            return true;
     }
-    return is_ready;
+    return false;
 }
 
-bool Node::BorrowIo(std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
-    input_tensors_.clear();
+Node::AlignResult Node::AlignInputs(bool *is_urgent) {
+    // The frames are matched by id, the delay edges carry the former frame.
+    int num_forward = 0;
+    int num_urgent = 0;
+    int num_normal = 0;
+    for (int i=0; i<input_queues_.size(); i++) {
+        if (input_queues_[i]->is_delay)
+            continue;
+        num_forward++;
+        num_urgent += input_queues_[i]->full.size(true) > 0 ? 1 : 0;
+        num_normal += input_queues_[i]->full.size(false) > 0 ? 1 : 0;
+    }
+    *is_urgent = true;
+    if (num_forward < 2)
+        return ALIGNED;
+    if (num_urgent < num_forward) {
+        *is_urgent = false;
+        // The urgent frame is on the way to the other inputs, or was dropped.
+        if (num_normal < num_forward) {
+            for (int i=0; i<input_queues_.size(); i++)
+                input_queues_[i]->UnreserveFull();
+            return UNMATCHED;
+        }
+    }
+
+    std::vector<int> ids(input_queues_.size());
+    int max_id = 0;
+    bool is_aligned = true;
+    for (int i=0, n=0; i<input_queues_.size(); i++) {
+        if (input_queues_[i]->is_delay)
+            continue;
+        Tensor *t;
+        input_queues_[i]->PeekFull(&t, *is_urgent);
+        ids[i] = t->id();
+        if (n > 0 && ids[i] != max_id)
+            is_aligned = false;
+        max_id = n++ == 0 ? ids[i] : std::max(max_id, ids[i]);
+    }
+    if (is_aligned)
+        return ALIGNED;
+    // The older frames will never be matched, drop them and give back the others.
+    for (int i=0; i<input_queues_.size(); i++) {
+        if (!input_queues_[i]->is_delay && ids[i] < max_id) {
+            Tensor *t;
+            input_queues_[i]->TakeFull(&t, *is_urgent);
+            input_queues_[i]->num_dropped++;
+            input_queues_[i]->PushFree(t);
+        }
+        else {
+            input_queues_[i]->UnreserveFull();
+        }
+    }
+    return DROPPED;
+}
+
+void Node::OnInputPushed(bool is_urgent) {
+    if (!is_urgent && !is_matching_.load())
+        return;
+    is_matching_ = false;
+    if (num_unready_ == 0 && ready_notifier_)
+        ready_notifier_(this);
+}
+
+bool Node::HasUrgentInput() {
+    for (int i=0; i<input_queues_.size(); i++) {
+        if (input_queues_[i]->full.size(true) > 0)
+            return true;
+    }
+    return false;
+}
+
+bool Node::BorrowIo(IoContext *ctx) {
+    std::unique_lock<std::mutex> lock(borrow_mutex_, std::defer_lock);
+    if (num_replica_ > 1)
+        lock.lock();
+    // Check again under the lock, the other replicas may have taken the data.
+    if (!CheckIoIsReady())
+        return false;
+
+    // Reserve all the inputs first, the producer of a dropping edge may take its data back.
+    // A join also keeps the producers from dropping the heads it matches until they are taken.
+    std::vector<std::unique_lock<std::mutex>> drop_locks;
+    if (input_queues_.size() > 1) {
+        for (int i=0; i<input_queues_.size(); i++) {
+            if (input_queues_[i]->overflow == DROP_OLDEST || input_queues_[i]->overflow == KEEP_LATEST)
+                drop_locks.emplace_back(input_queues_[i]->drop_mutex);
+        }
+    }
+    bool is_urgent = true;
+    while (true) {
+        for (int i=0; i<input_queues_.size(); i++) {
+            if (!input_queues_[i]->ReserveFull()) {
+                for (int j=0; j<i; j++)
+                    input_queues_[j]->UnreserveFull();
+                return false;
+            }
+        }
+        AlignResult result = AlignInputs(&is_urgent);
+        if (result == ALIGNED)
+            break;
+        // Check again after marking, a push in between clears the mark.
+        if (result == UNMATCHED && is_matching_.exchange(true))
+            return false;
+        if (!CheckIoIsReady())
+            return false;
+    }
+    ctx->input_tensors.clear();
     // printf("input_queues_.size: %d.\n", input_queues_.size());
     for (int i=0; i<input_queues_.size(); i++) {
         Tensor *inside_full;
         // printf("input_queues_[%d]->full.size : %d.\n", i, input_queues_[i]->full.size());
-        bool is_ready = input_queues_[i]->full.wait_and_pop(&inside_full);
+        bool is_ready = input_queues_[i]->TakeFull(&inside_full, is_urgent || input_queues_[i]->is_delay);
         if (!is_ready) return false;
-        input_tensors_.push_back(inside_full);
+        ctx->input_tensors.push_back(inside_full);
     }
-    output_tensors_.clear();
+    drop_locks.clear();
+    ctx->output_tensors.clear();
     // printf("output_queues_.size: %d.\n", output_queues_.size());
     for (int i=0; i<output_queues_.size(); i++) {
         Tensor *inside_free;
         // printf("output_queues_[%d]->free.size : %d.\n", i, output_queues_[i]->free.size());
-        bool is_ready = output_queues_[i]->free.wait_and_pop(&inside_free);
+        bool is_ready = output_queues_[i]->AcquireFree(&inside_free);
         if (!is_ready) return false;
-        output_tensors_.push_back(inside_free);
+        ctx->output_tensors.push_back(inside_free);
     }
+    ctx->seq = borrow_seq_++;
+    if (lock.owns_lock())
+        lock.unlock();
+
     // Get ITensor, TODO 直接拷贝
+    std::vector<ITensor *> &inputs = ctx->inputs;
+    std::vector<ITensor *> &outputs = ctx->outputs;
     inputs.clear();
-    for (int i=0; i<input_tensors_.size(); i++) {
-        inputs.push_back(input_tensors_[i]);
+    for (int i=0; i<ctx->input_tensors.size(); i++) {
+        inputs.push_back(ctx->input_tensors[i]);
     }
     outputs.clear();
-    for (int i=0; i<output_tensors_.size(); i++) {
-        outputs.push_back(output_tensors_[i]);
+    for (int i=0; i<ctx->output_tensors.size(); i++) {
+        outputs.push_back(ctx->output_tensors[i]);
     }
-    // Check id
-    for (int i=1; i<inputs.size(); i++) {
-        if (inputs[i]->id() != inputs[0]->id()) {
+    // Check id, the delay edges carry the former frame.
+    int id_port = 0;
+    while (id_port + 1 < inputs.size() && input_queues_[id_port]->is_delay)
+        id_port++;
+    for (int i=0; i<inputs.size(); i++) {
+        if (!input_queues_[i]->is_delay && inputs[i]->id() != inputs[id_port]->id()) {
             ECAS_LOGE("Node::BorrowIo -> The ID of Tensor in the same group is inconsistent.\n");
         }
     }
     // Pass id
     for (int i=0; i<outputs.size(); i++) {
-        outputs[i]->SetId(inputs[0]->id());
+        outputs[i]->SetId(inputs[id_port]->id());
+        outputs[i]->SetStreamId(inputs[id_port]->stream_id());
+        outputs[i]->SetPriority(inputs[id_port]->priority());
     }
     return true;
 }
 
-void Node::RecycleIo() {
+void Node::RecycleIo(IoContext *ctx) {
     // TODO: 按需进行异步的跨设备内存拷贝。
     for (int i=0; i<input_queues_.size(); i++) {
-        input_queues_[i]->free.push(input_tensors_[i]);
+        input_queues_[i]->PushFree(ctx->input_tensors[i]);
     }
-    for (int i=0; i<output_queues_.size(); i++) {
-        output_queues_[i]->full.push(output_tensors_[i]);
+    if (num_replica_ == 1) {
+        for (int i=0; i<output_queues_.size(); i++) {
+            output_queues_[i]->PushFull(ctx->output_tensors[i]);
+        }
+        return;
+    }
+    // Restore the order for the downstream nodes.
+    std::unique_lock<std::mutex> lock(commit_mutex_);
+    pending_outputs_[ctx->seq] = ctx->output_tensors;
+    std::map<uint64_t, std::vector<Tensor *>>::iterator iter = pending_outputs_.begin();
+    while (iter != pending_outputs_.end() && iter->first == commit_seq_) {
+        for (int i=0; i<output_queues_.size(); i++) {
+            output_queues_[i]->PushFull(iter->second[i]);
+        }
+        commit_seq_++;
+        iter = pending_outputs_.erase(iter);
     }
 }
 
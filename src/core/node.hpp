@@ -6,6 +6,10 @@
 #define ECAS_CORE_NODE_HPP_
 
 #include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include "allocator.hpp"
 #include "ecas/ecas.hpp"
 
@@ -17,35 +21,90 @@ namespace ecas {
 // struct Params;
 // TODO: 可选择已注册的kernel函数，也可以外设自己的函数
 
+// The tensors borrowed by one run of the node. Each worker has its own,
+// so that the replicas of a node can run at the same time.
+struct IoContext {
+    std::vector<Tensor *> input_tensors;
+    std::vector<Tensor *> output_tensors;
+    std::vector<ITensor *> inputs;
+    std::vector<ITensor *> outputs;
+    uint64_t seq; // Borrowing order, the outputs are committed in this order.
+};
+
 class Node {
 public:
-    Node(): input_nodes_(nullptr), output_nodes_(nullptr) {}
+    Node(): input_nodes_(nullptr), output_nodes_(nullptr), group_id_(0), num_replica_(1),
+            num_running_(0), is_dirty_(false), num_unready_(0), is_matching_(false), borrow_seq_(0), commit_seq_(0),
+            state_size_(0) {}
     virtual ~Node() {};
     virtual void Run(void *usr, std::vector<ITensor *> &input, std::vector<ITensor *> &output) = 0;
+    // Run with the TaskContext of the frame, the ids have been passed to the outputs.
+    void Invoke(void *usr, std::vector<ITensor *> &input, std::vector<ITensor *> &output);
 
     inline std::string &name() { return name_; }
     inline void SetInputNodes(std::vector<Node *> *input_nodes) { input_nodes_ = input_nodes; };
     inline void SetOutputNodes(std::vector<Node *> *output_nodes) { output_nodes_ = output_nodes; };
 
+    inline int group_id() const { return group_id_; }
+    inline void SetGroupId(int group_id) { group_id_ = group_id; }
+    // Number of runs of the node at the same time, the task should be reentrant if > 1.
+    // It takes effect with WORK_STEALING, set it before BuildGraph.
+    inline int num_replica() const { return num_replica_; }
+    inline void SetNumReplica(int num) { num_replica_ = num > 1 ? num : 1; }
+
+    // Per-stream state, see Session::DeclareNodeState.
+    inline uint32_t state_size() const { return state_size_; }
+    inline void SetStateSize(uint32_t size) { state_size_ = size; }
+    void *GetState(int stream_id);
+    // Drop the states of all the streams, they start from zeros again.
+    virtual void ResetStates();
+
     inline std::vector<Node *> *input_nodes() { return input_nodes_; }
     inline std::vector<Node *> *output_nodes() { return output_nodes_; }
 
     inline std::vector<std::vector<int>> &input_dims() { return input_dims_; }
     inline std::vector<std::vector<int>> &output_dims() { return output_dims_; }
 
-    inline void AppendInputs(BlockingQueuePair *bq) { input_queues_.push_back(bq); }
-    inline void AppendOutputs(BlockingQueuePair *bq) { output_queues_.push_back(bq); }
+    void AppendInputs(BlockingQueuePair *bq);
+    void AppendOutputs(BlockingQueuePair *bq);
     inline std::vector<BlockingQueuePair *> &input_queues() { return input_queues_; }
     inline std::vector<BlockingQueuePair *> &output_queues() { return output_queues_; }
 
     void ReorderInputQueues();
     void ReorderOutputQueues();
 
+    // Called by the BlockingQueuePairs when the data of an input port or the free slot
+    // of an output port becomes available (is_ready) or runs out.
+    void OnPortChanged(bool is_ready);
+    // It will be called once all the ports have become available.
+    inline void SetReadyNotifier(std::function<void(Node *)> notifier) { ready_notifier_ = notifier; }
+    // Called by the input BlockingQueuePairs after each push. The node is notified again for
+    // an urgent frame, or if it is waiting for the frames to be matched, see AlignInputs.
+    void OnInputPushed(bool is_urgent);
+    // Some input has an urgent frame, the scheduler runs the node first.
+    bool HasUrgentInput();
+
     bool CheckIoIsReady();
-    bool BorrowIo(std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs);
-    void RecycleIo();
+    // Returns false if the ports are not ready or the queues have exited.
+    bool BorrowIo(IoContext *ctx);
+    // The inputs are released at once, and the outputs are committed in the borrowing order.
+    void RecycleIo(IoContext *ctx);
+
+    // Used by WorkerPool, at most num_replica workers can run the node at a time.
+    // A node marked dirty while claimed will be checked again by its holder.
+    bool TryClaim();
+    inline void Unclaim() { num_running_--; }
+    inline void MarkDirty() { is_dirty_.store(true); }
+    inline bool ClearDirty() { return is_dirty_.exchange(false); }
 
 private:
+    // Joins: with all the inputs reserved, match the heads of the lane given by is_urgent.
+    // The urgent lane is used if every input has an urgent frame, otherwise the normal one.
+    // The frames older than the others are dropped (DROPPED), and if neither lane has a
+    // frame on every input, it waits for the next push (UNMATCHED). The reservations are
+    // given back if not ALIGNED.
+    enum AlignResult { ALIGNED, DROPPED, UNMATCHED };
+    AlignResult AlignInputs(bool *is_urgent);
     void SwapQueueOrder(std::vector<BlockingQueuePair *> &queues, int i, int j);
 
 protected:
@@ -54,6 +113,16 @@ protected:
     std::vector<Node *> *input_nodes_;
     std::vector<Node *> *output_nodes_;
 
+    int group_id_; // Thread group, or an affinity hint for WorkerPool.
+    int num_replica_;
+    std::atomic<int> num_running_;
+    std::atomic<bool> is_dirty_;
+    // The number of ports that can not be borrowed now.
+    std::atomic<int> num_unready_;
+    // Waiting for a push to match the inputs.
+    std::atomic<bool> is_matching_;
+    std::function<void(Node *)> ready_notifier_;
+
     // 0: data_type, 1, 2, 3...
     std::vector<std::vector<int>> input_dims_;
     std::vector<std::vector<int>> output_dims_;
@@ -61,8 +130,18 @@ protected:
     std::vector<BlockingQueuePair *> input_queues_; // It is also part of the output of the input node 
     std::vector<BlockingQueuePair *> output_queues_; // It is also part of the input of the output node
 
-    std::vector<Tensor *> input_tensors_;
-    std::vector<Tensor *> output_tensors_;
+    // For replicas, borrowing is serialized, and the outputs finished out of order wait
+    // in pending_outputs_ until the former ones are committed.
+    std::mutex borrow_mutex_;
+    std::mutex commit_mutex_;
+    uint64_t borrow_seq_;
+    uint64_t commit_seq_;
+    std::map<uint64_t, std::vector<Tensor *>> pending_outputs_;
+
+    // <stream id, state>
+    uint32_t state_size_;
+    std::mutex state_mutex_;
+    std::map<int, std::vector<char>> states_;
 };
 
 }  // end of namespace ecas.
@@ -0,0 +1,167 @@
+/*!
+* \brief Profiler.
+*/
+
+#include "profiler.hpp"
+
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+
+#include "util/timer.hpp"
+#include "util/logger.hpp"
+
+namespace ecas {
+
+// Keep the memory bounded in a long run, about 48 MB.
+#define ECAS_PROFILE_MAX_EVENTS (1 << 20)
+
+Profiler::Profiler() {
+    is_started_ = false;
+    start_ns_ = 0;
+    sample_us_ = 1000;
+}
+
+Profiler::~Profiler() {
+    Stop();
+    for (int i = 0; i < idle_since_.size(); i++)
+        delete idle_since_[i];
+}
+
+void Profiler::Start(std::vector<Node *> &nodes, Allocator *allocator, int sample_us) {
+    if (is_started_)
+        return;
+
+    events_.clear();
+    node_tracks_.clear();
+    for (int i = 0; i < idle_since_.size(); i++)
+        delete idle_since_[i];
+    idle_since_.clear();
+
+    start_ns_ = util::NowNs();
+    for (int i = 0; i < nodes.size(); i++) {
+        node_tracks_[nodes[i]] = i;
+        idle_since_.push_back(new std::atomic<int64_t>(start_ns_));
+    }
+    allocator->GetBlockingQueues(&queues_);
+    queue_names_.clear();
+    for (int i = 0; i < queues_.size(); i++) {
+        queues_[i]->is_profiling = true;
+        queue_names_.push_back(queues_[i]->front_name + " -> " + queues_[i]->rear_name);
+    }
+
+    sample_us_ = std::max(sample_us, 100);
+    is_started_ = true;
+    sampler_ = std::thread([this]() -> void {
+        while (is_started_) {
+            Sample();
+            std::this_thread::sleep_for(std::chrono::microseconds(sample_us_));
+        }
+    });
+}
+
+void Profiler::Stop() {
+    if (!is_started_)
+        return;
+    is_started_ = false;
+    if (sampler_.joinable())
+        sampler_.join();
+    for (int i = 0; i < queues_.size(); i++)
+        queues_[i]->is_profiling = false;
+}
+
+void Profiler::AddEvent(const Event &e) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (events_.size() < ECAS_PROFILE_MAX_EVENTS)
+        events_.push_back(e);
+}
+
+void Profiler::Sample() {
+    int64_t now = util::NowNs();
+    for (int i = 0; i < queues_.size(); i++) {
+        BlockingQueuePair *bqp = queues_[i];
+        // The full queue of a broadcast source is not used, see its branches.
+        if (!bqp->branches.empty())
+            continue;
+        Event e = {queue_names_[i].c_str(), 'C', i, now, 0, bqp->num_full.load(),
+                   bqp->source != nullptr ? 0 : bqp->num_free.load()};
+        AddEvent(e);
+    }
+}
+
+void Profiler::RecordWait(Node *node, int64_t borrow_ns) {
+    std::map<Node *, int>::iterator iter = node_tracks_.find(node);
+    if (iter == node_tracks_.end())
+        return;
+    int64_t since = idle_since_[iter->second]->load();
+    // Waiting for the last input, then for the last free output slot.
+    int64_t input_ready = since;
+    for (int i = 0; i < node->input_queues().size(); i++)
+        input_ready = std::max(input_ready, node->input_queues()[i]->full_ready_ns.load());
+    input_ready = std::min(input_ready, borrow_ns);
+    int64_t output_ready = input_ready;
+    for (int i = 0; i < node->output_queues().size(); i++)
+        output_ready = std::max(output_ready, node->output_queues()[i]->free_ready_ns.load());
+    output_ready = std::min(output_ready, borrow_ns);
+
+    if (input_ready > since) {
+        Event e = {"starved", 'X', iter->second, since, input_ready - since, -1, -1};
+        AddEvent(e);
+    }
+    if (output_ready > input_ready) {
+        Event e = {"blocked", 'X', iter->second, input_ready, output_ready - input_ready, -1, -1};
+        AddEvent(e);
+    }
+}
+
+void Profiler::RecordRun(Node *node, int wid, int id, int64_t start_ns, int64_t end_ns) {
+    std::map<Node *, int>::iterator iter = node_tracks_.find(node);
+    if (iter == node_tracks_.end())
+        return;
+    Event e = {"run", 'X', iter->second, start_ns, end_ns - start_ns, id, wid};
+    AddEvent(e);
+    // With replicas, take the latest one.
+    std::atomic<int64_t> *since = idle_since_[iter->second];
+    int64_t prev = since->load();
+    while (prev < end_ns && !since->compare_exchange_weak(prev, end_ns)) {}
+}
+
+bool Profiler::WriteChromeTrace(const std::string &path) {
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        ECAS_LOGW("Profiler::WriteChromeTrace -> Can not open %s.\n", path.c_str());
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    // pid 1: the nodes, one track for each. pid 2: the queues.
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"nodes\"}},\n");
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 2, \"args\": {\"name\": \"queues\"}}");
+    for (std::map<Node *, int>::iterator iter = node_tracks_.begin(); iter != node_tracks_.end(); iter++) {
+        fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                iter->second, iter->first->name().c_str());
+    }
+    for (int i = 0; i < events_.size(); i++) {
+        Event &e = events_[i];
+        double ts = (e.ts_ns - start_ns_) / 1000.0;
+        if (e.phase == 'X') {
+            fprintf(fp, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    e.name, e.tid, ts, e.dur_ns / 1000.0);
+            if (e.arg0 >= 0)
+                fprintf(fp, ", \"args\": {\"id\": %d, \"worker\": %d}", e.arg0, e.arg1);
+            fprintf(fp, "}");
+        }
+        else {
+            fprintf(fp, ",\n{\"name\": \"%s\", \"ph\": \"C\", \"pid\": 2, \"ts\": %.3f, \"args\": {\"full\": %d, \"free\": %d}}",
+                    e.name, ts, e.arg0, e.arg1);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    if (events_.size() >= ECAS_PROFILE_MAX_EVENTS)
+        ECAS_LOGW("Profiler::WriteChromeTrace -> Events are truncated at %d.\n", ECAS_PROFILE_MAX_EVENTS);
+    ECAS_LOGI("Profiler: %d events are written to %s.\n", (int)events_.size(), path.c_str());
+    return true;
+}
+
+}  // end of namespace ecas.
@@ -0,0 +1,71 @@
+/*!
+* \brief Profiler.
+*        记录节点运行区间、等待区间(输入饥饿/输出阻塞)和队列占用随时间的变化，
+*        导出为Chrome trace json，可在chrome://tracing或Perfetto中打开。
+*/
+
+#ifndef ECAS_CORE_PROFILER_HPP_
+#define ECAS_CORE_PROFILER_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include "node.hpp"
+#include "allocator.hpp"
+
+namespace ecas {
+
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+
+    inline bool is_started() const { return is_started_; }
+
+    // Each node has its own track, and the queues are sampled every sample_us.
+    void Start(std::vector<Node *> &nodes, Allocator *allocator, int sample_us = 1000);
+    void Stop();
+
+    // Called by the worker after BorrowIo, the wait since the last run of the node
+    // is split by the time when its inputs and outputs became available.
+    void RecordWait(Node *node, int64_t borrow_ns);
+    void RecordRun(Node *node, int wid, int id, int64_t start_ns, int64_t end_ns);
+
+    bool WriteChromeTrace(const std::string &path);
+
+private:
+    struct Event {
+        const char *name;
+        char phase;      // 'X': complete event, 'C': counter.
+        int tid;         // The track.
+        int64_t ts_ns;
+        int64_t dur_ns;
+        int arg0;        // 'X': frame id, 'C': full slots.
+        int arg1;        // 'X': worker id, 'C': free slots.
+    };
+    void AddEvent(const Event &e);
+    void Sample();
+
+private:
+    std::atomic<bool> is_started_;
+    int64_t start_ns_;
+    int sample_us_;
+    std::thread sampler_;
+
+    std::mutex mutex_;
+    std::vector<Event> events_;
+    // Node -> track id, and the time when each node finished its last run.
+    std::map<Node *, int> node_tracks_;
+    std::vector<std::atomic<int64_t> *> idle_since_;
+
+    std::vector<BlockingQueuePair *> queues_;
+    std::vector<std::string> queue_names_;
+};
+
+}  // end of namespace ecas.
+
+#endif // ECAS_CORE_PROFILER_HPP_
@@ -4,21 +4,33 @@
 
 #include "scheduler.hpp"
 
-#include <queue>
 #include <chrono>
+#include <limits>
+#include <algorithm>
 
 namespace ecas {
 
 Scheduler::Scheduler() {
     is_stop_ = false;
+    policy_ = GROUP_THREAD;
+    num_thread_ = 1;
     groups_.clear();
 }
 
 Scheduler::~Scheduler() {
 }
 
+void Scheduler::SetPolicy(SchedulePolicy policy, int num_thread) {
+    policy_ = policy;
+    num_thread_ = num_thread;
+}
+
+void Scheduler::SetGroupAttrs(const std::vector<GroupAttr> &attrs) {
+    group_attrs_ = attrs;
+}
+
 // TODO: 可以有缺省id号，在未设置id号时，自动给其新增一个只有它自己的group。
-//       默认每个节点都各开一个线程，分组主要目的是为了绑核。
+//       分组主要目的是为了绑核。
 void Scheduler::MarkGroupId(Node *node, int group_id) {
     static int init_size = 10;
     if (groups_temp_.size() != init_size) {
@@ -28,14 +40,27 @@ void Scheduler::MarkGroupId(Node *node, int group_id) {
         ECAS_LOGE("group_id should be smaller than %d.\n", groups_temp_.size());
     }
     groups_temp_[group_id].push_back(node);
+    node->SetGroupId(group_id);
+}
+
+void Scheduler::UnmarkGroupId(Node *node) {
+    for (int i=0; i<groups_temp_.size(); i++) {
+        std::vector<Node *> &group = groups_temp_[i];
+        group.erase(std::remove(group.begin(), group.end(), node), group.end());
+    }
 }
 
 void Scheduler::UpdateGroups() {
     groups_.clear();
+    group_ids_.clear();
     for (int i=0; i<groups_temp_.size(); i++) {
         if (groups_temp_[i].size() == 0)
             continue;
+        // Empty groups are removed, let the group id of the node be the index of its thread.
+        for (int j=0; j<groups_temp_[i].size(); j++)
+            groups_temp_[i][j]->SetGroupId(groups_.size());
         groups_.push_back(groups_temp_[i]);
+        group_ids_.push_back(i);
     }
 }
 
@@ -50,23 +75,12 @@ void Scheduler::GetGraphNodes(std::vector<Node *> &graph_nodes) {
 
 ////////////////////////
 /// Serial Execution
-// TODO: 目前无法处理有环的情况
-void Scheduler::BfsExecute(Node *input_node, ITensor *input_data) {
-    std::queue<Node *> tasks;
-    tasks.push(input_node);
-    while (!tasks.empty()) {
-        Node *t = tasks.front();
-        // ITensor *input;
-        // ITensor *output;
-        // t->Run(input, output);
-        std::vector<Node *> *outs = t->output_nodes();
-        if (outs != nullptr) {
-            for (unsigned int i=0; i<outs->size(); i++) {
-                tasks.push((*outs)[i]);
-            }            
-        }
-        tasks.pop();
-    }
+void Scheduler::BuildSerialPlan(std::vector<Node *> &nodes, Allocator *allocator, Topology *topo) {
+    serial_plan_.Build(nodes, allocator, topo);
+}
+
+void Scheduler::SerialExecute(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    serial_plan_.Run(usr, inputs, outputs);
 }
 
 ////////////////////////
@@ -75,7 +89,9 @@ void Scheduler::BuildGroup(std::map<std::string, Node *> &nodes,
                            std::vector<std::vector<std::string>> &&groups) {
     // groups_[group_id][node_ptr]
     groups_.resize(groups.size());
+    group_ids_.resize(groups.size());
     for (int i = 0; i < groups.size(); i++) {
+        group_ids_[i] = i;
         groups_[i].resize(groups[i].size());
         for (int j = 0; j < groups[i].size(); j++) {
             std::map<std::string, Node *>::iterator iter = nodes.find(groups[i][j]);
@@ -89,17 +105,116 @@ void Scheduler::BuildGroup(std::map<std::string, Node *> &nodes,
     }
 }
 
+std::vector<int> Scheduler::PartitionCosts(const std::vector<double> &costs, int k) {
+    int n = costs.size();
+    std::vector<double> prefix(n + 1, 0);
+    for (int i = 0; i < n; i++)
+        prefix[i + 1] = prefix[i] + costs[i];
+    // best[p][i]: the min of the max part cost, splitting the first i costs into p parts.
+    std::vector<std::vector<double>> best(k + 1, std::vector<double>(n + 1, std::numeric_limits<double>::max()));
+    std::vector<std::vector<int>> split(k + 1, std::vector<int>(n + 1, 0));
+    best[0][0] = 0;
+    for (int p = 1; p <= k; p++) {
+        for (int i = p; i <= n; i++) {
+            for (int j = p - 1; j < i; j++) {
+                if (best[p - 1][j] == std::numeric_limits<double>::max())
+                    continue;
+                double cost = std::max(best[p - 1][j], prefix[i] - prefix[j]);
+                if (cost < best[p][i]) {
+                    best[p][i] = cost;
+                    split[p][i] = j;
+                }
+            }
+        }
+    }
+    std::vector<int> firsts(k);
+    for (int p = k, i = n; p > 0; p--) {
+        i = split[p][i];
+        firsts[p - 1] = i;
+    }
+    return firsts;
+}
+
+void Scheduler::AutoGroup(void *usr, std::vector<Node *> &nodes, Allocator *allocator, Topology *topo,
+                          ITensor *sample, int num_iter) {
+    // Calibrate on the caller's thread with the serial plan.
+    serial_plan_.Build(nodes, allocator, topo);
+    if (serial_plan_.num_inputs() != 1 || serial_plan_.num_outputs() != 1)
+        ECAS_LOGE("AutoGroup -> Only supports the graph with one input and one output.\n");
+    std::vector<int> &dims = serial_plan_.output_dims(0);
+    std::vector<int> shape(dims.begin() + 1, dims.end());
+    Tensor *out = allocator->CreateTensor(shape, (DataType)dims[0], nullptr);
+    std::vector<ITensor *> inputs = {sample};
+    std::vector<ITensor *> outputs = {out};
+
+    std::vector<double> step_us;
+    serial_plan_.Run(usr, inputs, outputs); // Warm up.
+    for (int i = 0; i < num_iter; i++)
+        serial_plan_.Run(usr, inputs, outputs, &step_us);
+    int num_step = serial_plan_.num_steps();
+    double total_us = 0;
+    for (int i = 0; i < num_step; i++) {
+        step_us[i] /= num_iter;
+        total_us += step_us[i];
+    }
+    // Leave nothing of the measuring runs to the real frames.
+    allocator->ReleaseTensor(out);
+    for (int i = 0; i < nodes.size(); i++)
+        nodes[i]->ResetStates();
+
+    int k = num_thread_ > 0 ? num_thread_ : std::thread::hardware_concurrency();
+    k = std::max(1, std::min(k, num_step));
+    std::vector<int> firsts = PartitionCosts(step_us, k);
+
+    groups_.clear();
+    group_ids_.clear();
+    groups_.resize(k);
+    group_ids_.resize(k);
+    double max_us = 0;
+    ECAS_LOGS("Auto grouping (%d nodes, %d groups): \n", num_step, k);
+    for (int g = 0; g < k; g++) {
+        int last = g + 1 < k ? firsts[g + 1] : num_step;
+        double group_us = 0;
+        ECAS_LOGS("%d -> ", g);
+        for (int i = firsts[g]; i < last; i++) {
+            Node *n = serial_plan_.step_node(i);
+            n->SetGroupId(g);
+            groups_[g].push_back(n);
+            group_us += step_us[i];
+            ECAS_LOGS("%s (%.1f us)%s", n->name().c_str(), step_us[i], i + 1 < last ? ", " : "");
+        }
+        group_ids_[g] = g;
+        max_us = std::max(max_us, group_us);
+        ECAS_LOGS(" | %.1f us\n", group_us);
+    }
+    if (max_us > 0) {
+        ECAS_LOGS("Predicted throughput: %.1f fps (serial: %.1f fps).\n",
+                  1e6 / max_us, 1e6 / total_us);
+    }
+}
+
 void Scheduler::ShowGroups() {
     ECAS_LOGS("Groups: \n");
     for (int i = 0; i < groups_.size(); i++) {
         if (groups_[i].size() == 0)
             ECAS_LOGE("ShowGroups -> groups_[%d].size() == 0.\n", i)
 
-        ECAS_LOGS("%d -> ", i);
+        ECAS_LOGS("%d (id %d) -> ", i, group_ids_[i]);
         for (int j = 0; j < groups_[i].size(); j++) {
             ECAS_LOGS("%s", ((Node *)groups_[i][j])->name().c_str()); // groups_[i][j]
             if (j != groups_[i].size() - 1) ECAS_LOGS(", ");
         }
+        for (int j = 0; j < group_attrs_.size(); j++) {
+            GroupAttr &attr = group_attrs_[j];
+            if (attr.group_id != group_ids_[i])
+                continue;
+            ECAS_LOGS(" | cpus: [");
+            for (int k = 0; k < attr.cpus.size(); k++) {
+                ECAS_LOGS("%d", attr.cpus[k]);
+                if (k != attr.cpus.size() - 1) ECAS_LOGS(",");
+            }
+            ECAS_LOGS("], priority: %d, nice: %d", attr.priority, attr.nice);
+        }
         ECAS_LOGS("\n");
     }
 }
@@ -109,39 +224,48 @@ void Scheduler::TasksSpawn(void *usr) {
         ECAS_LOGE("TasksSpawn -> groups_.size() == 0, please call function BuildGraph first.\n");
     }
 
-    std::vector<std::vector<Node *>> &groups = groups_;
-    printf("group size: %d.\n", groups_.size());
-    for (unsigned i = 0; i < groups.size(); ++i) {
-        threads_.emplace_back([this, i, groups, usr]() -> void {
-            std::vector<ITensor *> inputs;
-            std::vector<ITensor *> outputs;
-            while (!is_stop_) {
-                // 同一组的按顺序堵塞执行，不会有帧差
-                for (int ni=0; ni<groups[i].size(); ni++) {
-                    Node *n = groups[i][ni];
-                    // printf("Start BorrowIo: %s.\n", n->name().c_str());
-                    bool ret = n->BorrowIo(inputs, outputs);
-                    if (ret == false) break;
-                    // printf("%s -> (%d, %d).\n", n->name().c_str(), inputs.size(), outputs.size());
-                    n->Run(usr, inputs, outputs);
-                    n->RecycleIo();
-                }
+    // GROUP_THREAD: one worker for each group and no stealing, the nodes of a group
+    // run whenever they are ready, so an empty queue will not block the whole group.
+    // WORK_STEALING: the group id is only a hint.
+    // Worker i is the home of groups_[i].
+    std::vector<GroupAttr> attrs(groups_.size());
+    for (int i = 0; i < groups_.size(); i++) {
+        attrs[i].group_id = group_ids_[i];
+        for (int j = 0; j < group_attrs_.size(); j++) {
+            if (group_attrs_[j].group_id == group_ids_[i])
+                attrs[i] = group_attrs_[j];
+        }
+    }
+
+    is_stop_ = false;
+    if (policy_ == WORK_STEALING)
+        pool_.Start(num_thread_, true, usr, attrs);
+    else
+        pool_.Start(groups_.size(), false, usr, attrs);
+
+    for (int i = 0; i < groups_.size(); i++) {
+        for (int j = 0; j < groups_[i].size(); j++) {
+            Node *n = groups_[i][j];
+            if (n->num_replica() > 1 && policy_ != WORK_STEALING) {
+                ECAS_LOGW("TasksSpawn -> The replicas of %s run one by one without WORK_STEALING.\n",
+                          n->name().c_str());
             }
-            ECAS_LOGI("is_stop_: %d.\n", is_stop_);
-        });
+            n->SetReadyNotifier([this](Node *node) -> void { pool_.Submit(node); });
+            // Let the workers check every node once.
+            pool_.Submit(n);
+        }
     }
-    ECAS_LOGI("Scheduler::TasksSpawn End.\n");
+    ECAS_LOGI("Scheduler::TasksSpawn End (%d workers).\n", pool_.num_worker());
 }
 
 void Scheduler::TasksStop(Allocator *pool) {
     is_stop_ = true;
+    pool_.Stop();
     pool->ExitAllBlockingQueue();
 }
 
 void Scheduler::TasksJoin() {
-    for (auto& t : threads_) {
-        t.join();
-    }
+    pool_.Join();
 }
 
-}  // end of namespace ecas.
\ No newline at end of file
+}  // end of namespace ecas.
@@ -12,6 +12,8 @@
 #include <map>
 
 #include "node.hpp"
+#include "worker_pool.hpp"
+#include "serial_plan.hpp"
 #include "util/logger.hpp"
 
 namespace ecas {
@@ -22,38 +24,55 @@ public:
     Scheduler();
     ~Scheduler();
 
+    void SetPolicy(SchedulePolicy policy, int num_thread);
+    void SetGroupAttrs(const std::vector<GroupAttr> &attrs);
     void MarkGroupId(Node *node, int group_id);
+    void UnmarkGroupId(Node *node);
     void UpdateGroups();
     void GetGraphNodes(std::vector<Node *> &graph_nodes);
 
     ////////////////////////
     /// Serial Execution
-    // Breadth First.
-    void BuildBfsPass(Node *input_node) {}
-    void BfsExecute(Node *input_node, ITensor *input_data);
+    // Topological order, all nodes run on the caller's thread.
+    void BuildSerialPlan(std::vector<Node *> &nodes, Allocator *allocator, Topology *topo);
+    void SerialExecute(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs);
+    inline SerialPlan &serial_plan() { return serial_plan_; }
 
     ////////////////////////
     /// Parallel execution
-    // Group nodes, and each group uses one thread.
+    // Group nodes, and each group uses one thread in GROUP_THREAD mode.
     void BuildGroup(std::map<std::string, Node*> &nodes, 
                     std::vector<std::vector<std::string>> &&groups);
     void ShowGroups();
+    // Run the nodes one by one with the sample to measure their costs, then split them
+    // in topological order into num_thread groups, minimizing the cost of the slowest group.
+    // The group ids of the nodes are replaced by the index of their new group.
+    void AutoGroup(void *usr, std::vector<Node *> &nodes, Allocator *allocator, Topology *topo,
+                   ITensor *sample, int num_iter);
+    // Contiguous partition of costs into k parts, returns the first index of each part.
+    static std::vector<int> PartitionCosts(const std::vector<double> &costs, int k);
     inline int group_size() { return groups_.size(); }
     // inline std::vector<std::vector<Node *>> &group_nodes() { return groups_; };
+    inline void SetProfiler(Profiler *profiler) { pool_.SetProfiler(profiler); }
     void TasksSpawn(void *usr);
     void TasksStop(Allocator *pool);
     void TasksJoin();
 
 private:
     /// Serial Execution
-    std::vector<Node *> bfs_nodes_;
+    SerialPlan serial_plan_;
 
     /// Parallel execution
     // groups_[group_id][node_ptr]
     std::vector<std::vector<Node *>> groups_;
     std::vector<std::vector<Node *>> groups_temp_;
+    // The group id given by user of groups_[i].
+    std::vector<int> group_ids_;
+    std::vector<GroupAttr> group_attrs_;
 
-    std::vector<std::thread> threads_;
+    SchedulePolicy policy_;
+    int num_thread_;
+    WorkerPool pool_;
     bool is_stop_;
 };
 
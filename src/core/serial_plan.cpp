@@ -0,0 +1,320 @@
+/*!
+* \brief SerialPlan.
+*/
+
+#include "serial_plan.hpp"
+
+#include <map>
+#include <queue>
+#include <chrono>
+#include <algorithm>
+
+#include "memory_planner.hpp"
+#include "util/logger.hpp"
+#include "util/common.hpp"
+
+namespace ecas {
+
+SerialPlan::SerialPlan() {
+    arena_ = nullptr;
+    planned_size_ = 0;
+    naive_size_ = 0;
+}
+
+SerialPlan::~SerialPlan() {}
+
+// Kahn's algorithm, only the edges inside the set are considered.
+void SerialPlan::SortNodes(std::vector<Node *> &nodes, std::vector<Node *> &sorted, Topology *topo) {
+    std::map<Node *, int> in_degree;
+    for (int i = 0; i < nodes.size(); i++)
+        in_degree[nodes[i]] = 0;
+    for (int i = 0; i < nodes.size(); i++) {
+        std::vector<Node *> *ins = nodes[i]->input_nodes();
+        if (ins == nullptr) continue;
+        for (int j = 0; j < ins->size(); j++) {
+            if (in_degree.count((*ins)[j]) && !(topo != nullptr && topo->IsDelayEdge((*ins)[j], nodes[i])))
+                in_degree[nodes[i]]++;
+        }
+    }
+
+    std::queue<Node *> ready;
+    for (int i = 0; i < nodes.size(); i++) {
+        if (in_degree[nodes[i]] == 0)
+            ready.push(nodes[i]);
+    }
+    sorted.clear();
+    while (!ready.empty()) {
+        Node *n = ready.front();
+        ready.pop();
+        sorted.push_back(n);
+        std::vector<Node *> *outs = n->output_nodes();
+        if (outs == nullptr) continue;
+        for (int j = 0; j < outs->size(); j++) {
+            std::map<Node *, int>::iterator iter = in_degree.find((*outs)[j]);
+            if (iter == in_degree.end()) continue;
+            if (topo != nullptr && topo->IsDelayEdge(n, iter->first)) continue;
+            if (--iter->second == 0)
+                ready.push(iter->first);
+        }
+    }
+    if (sorted.size() != nodes.size()) {
+        ECAS_LOGE("SerialPlan::SortNodes -> Cycles are not supported (%d of %d nodes sorted).\n",
+                  (int)sorted.size(), (int)nodes.size());
+    }
+}
+
+void SerialPlan::Build(std::vector<Node *> &nodes, Allocator *allocator, Topology *topo) {
+    for (int i = 0; i < tensors_.size(); i++)
+        allocator->ReleaseTensor(tensors_[i]);
+    tensors_.clear();
+
+    std::vector<Node *> sorted;
+    SortNodes(nodes, sorted, topo);
+
+    std::map<Node *, int> step_index;
+    steps_.clear();
+    steps_.resize(sorted.size());
+    for (int i = 0; i < sorted.size(); i++) {
+        steps_[i].node = sorted[i];
+        steps_[i].inputs.resize(sorted[i]->input_dims().size(), nullptr);
+        steps_[i].outputs.resize(sorted[i]->output_dims().size(), nullptr);
+        steps_[i].id_port = 0;
+        step_index[sorted[i]] = i;
+    }
+
+    // One tensor for each inner edge, a broadcast output is one edge with several consumers.
+    struct Edge {
+        int src_step;
+        int src_port;
+        std::vector<Port> dsts;
+        int block;
+    };
+    std::vector<Edge> edges;
+    std::vector<std::vector<bool>> is_connected(steps_.size());
+    for (int si = 0; si < steps_.size(); si++)
+        is_connected[si].resize(steps_[si].inputs.size(), false);
+    MemoryPlanner planner;
+    input_ports_.clear();
+    output_ports_.clear();
+    delay_edges_.clear();
+    for (int si = 0; si < steps_.size(); si++) {
+        Node *n = steps_[si].node;
+        std::vector<Node *> *outs = n->output_nodes();
+        bool is_broadcast = outs != nullptr && n->output_dims().size() == 1 && outs->size() > 1;
+        for (int oi = 0; oi < n->output_dims().size(); oi++) {
+            std::vector<Node *> targets;
+            if (is_broadcast)
+                targets = *outs;
+            else if (outs != nullptr && oi < outs->size())
+                targets.push_back((*outs)[oi]);
+
+            Edge e = {si, oi, std::vector<Port>(), 0};
+            int last = si;
+            bool is_delay = false;
+            for (int ti = 0; ti < targets.size(); ti++) {
+                Node *target = targets[ti];
+                std::map<Node *, int>::iterator iter = step_index.find(target);
+                if (iter == step_index.end())
+                    continue;
+                // Find the free input port of the target connected to n.
+                std::vector<Node *> *target_ins = target->input_nodes();
+                int ii = 0;
+                for (; ii < target_ins->size(); ii++) {
+                    if ((*target_ins)[ii] == n && !is_connected[iter->second][ii])
+                        break;
+                }
+                if (ii == target_ins->size() || ii >= steps_[iter->second].inputs.size()) {
+                    ECAS_LOGE("SerialPlan::Build -> Can not find the input of %s for %s.\n",
+                              target->name().c_str(), n->name().c_str());
+                }
+                is_connected[iter->second][ii] = true;
+                if (n->output_dims()[oi] != target->input_dims()[ii]) {
+                    ECAS_LOGE("SerialPlan::Build -> Shape check failed (node %s to %s).\n",
+                              n->name().c_str(), target->name().c_str());
+                }
+                Port dst = {iter->second, ii};
+                if (topo != nullptr && topo->IsDelayEdge(n, target)) {
+                    if (is_broadcast) {
+                        ECAS_LOGE("SerialPlan::Build -> The delay edge %s -> %s can not be a broadcast.\n",
+                                  n->name().c_str(), target->name().c_str());
+                    }
+                    Port src = {si, oi};
+                    DelayEdge de = {src, dst, nullptr, nullptr, 0};
+                    delay_edges_.push_back(de);
+                    is_delay = true;
+                    continue;
+                }
+                e.dsts.push_back(dst);
+                last = std::max(last, iter->second);
+            }
+            if (is_delay)
+                continue;
+            if (e.dsts.empty()) {
+                Port port = {si, oi};
+                output_ports_.push_back(port);
+                continue;
+            }
+            if (e.dsts.size() != targets.size()) {
+                ECAS_LOGE("SerialPlan::Build -> The broadcast output of %s leaves the node set.\n",
+                          n->name().c_str());
+            }
+            // It is alive from the producer to the last consumer.
+            std::vector<int> &dims = n->output_dims()[oi];
+            uint32_t size = 0;
+            TYPE_SWITCH((DataType)dims[0], T, size = sizeof(T););
+            for (int di = 1; di < dims.size(); di++)
+                size *= dims[di];
+            e.block = planner.AddBlock(size, si, last);
+            edges.push_back(e);
+        }
+    }
+
+    // Edges with disjoint lifetimes share the same region of the arena.
+    planner.Plan();
+    planned_size_ = planner.planned_size();
+    naive_size_ = planner.naive_size();
+    if (arena_ != nullptr && arena_->size() < planned_size_) {
+        allocator->ReleaseArena(arena_);
+        arena_ = nullptr;
+    }
+    if (arena_ == nullptr && planned_size_ > 0)
+        arena_ = allocator->CreateArena(planned_size_);
+    char *arena = arena_ == nullptr ? nullptr : (char *)arena_->data();
+    for (int i = 0; i < edges.size(); i++) {
+        Edge &e = edges[i];
+        std::vector<int> &dims = steps_[e.src_step].node->output_dims()[e.src_port];
+        std::vector<int> shape(dims.begin() + 1, dims.end());
+        Tensor *t = allocator->CreateTensor(shape, (DataType)dims[0], arena + planner.offset(e.block));
+        tensors_.push_back(t);
+        steps_[e.src_step].outputs[e.src_port] = t;
+        for (int di = 0; di < e.dsts.size(); di++)
+            steps_[e.dsts[di].step].inputs[e.dsts[di].port] = t;
+    }
+    for (int i = 0; i < delay_edges_.size(); i++) {
+        DelayEdge &de = delay_edges_[i];
+        std::vector<int> &dims = steps_[de.src.step].node->output_dims()[de.src.port];
+        std::vector<int> shape(dims.begin() + 1, dims.end());
+        de.cur = allocator->CreateTensor(shape, (DataType)dims[0], nullptr);
+        de.next = allocator->CreateTensor(shape, (DataType)dims[0], nullptr);
+        tensors_.push_back(de.cur);
+        tensors_.push_back(de.next);
+        Node *src = steps_[de.src.step].node;
+        Node *dst = steps_[de.dst.step].node;
+        de.value = topo->GetEdgeAttr(src->name(), dst->name()).delay_value;
+        de.cur->Fill(de.value);
+        de.cur->SetId(-1);
+        // Mark the port as connected, the tensors are rebound in each Run.
+        steps_[de.dst.step].inputs[de.dst.port] = de.cur;
+        Step &step = steps_[de.dst.step];
+        if (step.id_port == de.dst.port && step.id_port + 1 < step.inputs.size())
+            step.id_port++;
+    }
+    for (int si = 0; si < steps_.size(); si++) {
+        for (int ii = 0; ii < steps_[si].inputs.size(); ii++) {
+            if (steps_[si].inputs[ii] == nullptr) {
+                Port port = {si, ii};
+                input_ports_.push_back(port);
+            }
+        }
+    }
+}
+
+std::vector<int> &SerialPlan::input_dims(int i) {
+    Port &port = input_ports_[i];
+    return steps_[port.step].node->input_dims()[port.port];
+}
+
+std::vector<int> &SerialPlan::output_dims(int i) {
+    Port &port = output_ports_[i];
+    return steps_[port.step].node->output_dims()[port.port];
+}
+
+int SerialPlan::FindInput(Node *node, int port) {
+    for (int i = 0; i < input_ports_.size(); i++) {
+        if (steps_[input_ports_[i].step].node == node && input_ports_[i].port == port)
+            return i;
+    }
+    return -1;
+}
+
+int SerialPlan::FindOutput(Node *node, int port) {
+    for (int i = 0; i < output_ports_.size(); i++) {
+        if (steps_[output_ports_[i].step].node == node && output_ports_[i].port == port)
+            return i;
+    }
+    return -1;
+}
+
+void SerialPlan::Run(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs,
+                     std::vector<double> *step_us) {
+    if (inputs.size() != input_ports_.size() || outputs.size() != output_ports_.size()) {
+        ECAS_LOGE("SerialPlan::Run -> io mismatch: (%d, %d) vs (%d, %d).\n", (int)inputs.size(), (int)outputs.size(),
+                  (int)input_ports_.size(), (int)output_ports_.size());
+    }
+    for (int i = 0; i < input_ports_.size(); i++) {
+        std::vector<int> &dims = input_dims(i);
+        if (inputs[i]->shape().size() != dims.size() - 1 ||
+            !std::equal(dims.begin() + 1, dims.end(), inputs[i]->shape().begin())) {
+            ECAS_LOGE("SerialPlan::Run -> Shape mismatch in input %d.\n", i);
+        }
+        steps_[input_ports_[i].step].inputs[input_ports_[i].port] = inputs[i];
+    }
+    for (int i = 0; i < output_ports_.size(); i++)
+        steps_[output_ports_[i].step].outputs[output_ports_[i].port] = outputs[i];
+    for (int i = 0; i < delay_edges_.size(); i++) {
+        DelayEdge &de = delay_edges_[i];
+        steps_[de.dst.step].inputs[de.dst.port] = de.cur;
+        steps_[de.src.step].outputs[de.src.port] = de.next;
+    }
+
+    for (int si = 0; si < steps_.size(); si++) {
+        Step &step = steps_[si];
+        // Pass id
+        if (!step.inputs.empty()) {
+            for (int i = 0; i < step.outputs.size(); i++) {
+                step.outputs[i]->SetId(step.inputs[step.id_port]->id());
+                step.outputs[i]->SetStreamId(step.inputs[step.id_port]->stream_id());
+                step.outputs[i]->SetPriority(step.inputs[step.id_port]->priority());
+            }
+        }
+        if (step_us == nullptr) {
+            step.node->Invoke(usr, step.inputs, step.outputs);
+            continue;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        step.node->Invoke(usr, step.inputs, step.outputs);
+        std::chrono::duration<double, std::micro> cost = std::chrono::steady_clock::now() - start;
+        step_us->resize(steps_.size(), 0);
+        (*step_us)[si] += cost.count();
+    }
+    // The outputs of this frame are the delayed inputs of the next one.
+    for (int i = 0; i < delay_edges_.size(); i++)
+        std::swap(delay_edges_[i].cur, delay_edges_[i].next);
+}
+
+void SerialPlan::ResetDelays() {
+    for (int i = 0; i < delay_edges_.size(); i++) {
+        delay_edges_[i].cur->Fill(delay_edges_[i].value);
+        delay_edges_[i].cur->SetId(-1);
+    }
+}
+
+void SerialPlan::Show() {
+    ECAS_LOGS("Serial plan: \n");
+    for (int si = 0; si < steps_.size(); si++) {
+        ECAS_LOGS("%d -> %s", si, steps_[si].node->name().c_str());
+        for (int i = 0; i < input_ports_.size(); i++) {
+            if (input_ports_[i].step == si)
+                ECAS_LOGS(" (input %d: port %d)", i, input_ports_[i].port);
+        }
+        for (int i = 0; i < output_ports_.size(); i++) {
+            if (output_ports_[i].step == si)
+                ECAS_LOGS(" (output %d: port %d)", i, output_ports_[i].port);
+        }
+        ECAS_LOGS("\n");
+    }
+    ECAS_LOGS("Intermediate memory: %u bytes planned, %u bytes without sharing.\n",
+              planned_size_, naive_size_);
+}
+
+}  // end of namespace ecas.
@@ -0,0 +1,94 @@
+/*!
+* \brief SerialPlan.
+*        将一组节点按拓扑序编排成串行执行计划，在调用线程上依次执行。
+*        节点间直接传递Tensor，不经过BlockingQueuePair，也没有线程切换。
+*/
+
+#ifndef ECAS_CORE_SERIAL_PLAN_HPP_
+#define ECAS_CORE_SERIAL_PLAN_HPP_
+
+#include <vector>
+
+#include "node.hpp"
+#include "allocator.hpp"
+#include "topology.hpp"
+
+namespace ecas {
+
+class SerialPlan {
+public:
+    SerialPlan();
+    ~SerialPlan();
+
+    inline bool is_built() const { return !steps_.empty(); }
+    inline int num_inputs() const { return input_ports_.size(); }
+    inline int num_outputs() const { return output_ports_.size(); }
+    inline uint32_t planned_size() const { return planned_size_; }
+    inline uint32_t naive_size() const { return naive_size_; }
+    inline int num_steps() const { return steps_.size(); }
+    inline Node *step_node(int i) { return steps_[i].node; }
+
+    // The edges between the nodes are taken from Node::input_nodes / output_nodes.
+    // The ports that are not connected to a node in the set become the inputs and
+    // outputs of the plan, ordered by the execution order of their nodes.
+    // The inner tensors are placed in one arena according to their lifetimes.
+    // The delay edges in topo are left out when sorting, their tensors keep the
+    // output of the former Run for the next one.
+    // Building again releases the tensors of the former build, and reuses its arena if large enough.
+    void Build(std::vector<Node *> &nodes, Allocator *allocator, Topology *topo = nullptr);
+    // Run all the nodes in order. The input / output tensors are bound to the plan
+    // ports directly, so there is no copy at the boundary.
+    // If step_us is not nullptr, the time of each step in microseconds is added to it.
+    void Run(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs,
+             std::vector<double> *step_us = nullptr);
+    // Refill the delay edges with their initial values, as if no frame has been run.
+    void ResetDelays();
+
+    // The shape of the plan port, data type saved in [0].
+    std::vector<int> &input_dims(int i);
+    std::vector<int> &output_dims(int i);
+    // The index of the plan port for the port of the node, -1 if it is not a plan port.
+    int FindInput(Node *node, int port);
+    int FindOutput(Node *node, int port);
+
+    void Show();
+
+private:
+    struct Step {
+        Node *node;
+        std::vector<ITensor *> inputs;
+        std::vector<ITensor *> outputs;
+        int id_port; // The first input that is not from a delay edge.
+    };
+    // <step index, port index>
+    struct Port {
+        int step;
+        int port;
+    };
+    // Double buffered, the consumer reads cur while the producer writes next.
+    struct DelayEdge {
+        Port src;
+        Port dst;
+        Tensor *cur;
+        Tensor *next;
+        float value; // The initial value.
+    };
+
+    void SortNodes(std::vector<Node *> &nodes, std::vector<Node *> &sorted, Topology *topo);
+
+private:
+    std::vector<Step> steps_;
+    std::vector<Port> input_ports_;
+    std::vector<Port> output_ports_;
+    std::vector<DelayEdge> delay_edges_;
+    // Created by Build, released by the next one.
+    std::vector<Tensor *> tensors_;
+    Buffer *arena_;
+
+    uint32_t planned_size_;
+    uint32_t naive_size_;
+};
+
+}  // end of namespace ecas.
+
+#endif // ECAS_CORE_SERIAL_PLAN_HPP_
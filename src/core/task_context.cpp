@@ -0,0 +1,50 @@
+/*!
+* \brief TaskContext.
+*/
+
+#include "task_context.hpp"
+#include "node.hpp"
+
+namespace ecas {
+
+static thread_local TaskScope *g_task_scope = nullptr;
+static thread_local util::ScratchArena g_scratch_arena;
+
+TaskScope::TaskScope(Node *node, int stream_id) {
+    node_ = node;
+    stream_id_ = stream_id;
+    prev_ = g_task_scope;
+    g_task_scope = this;
+    mark_ = g_scratch_arena.GetMark();
+}
+
+TaskScope::~TaskScope() {
+    g_scratch_arena.Reset(mark_);
+    g_task_scope = prev_;
+}
+
+TaskScope *TaskScope::current() {
+    return g_task_scope;
+}
+
+util::ScratchArena *TaskScope::arena() {
+    return &g_scratch_arena;
+}
+
+int TaskContext::StreamId() {
+    TaskScope *scope = TaskScope::current();
+    return scope == nullptr ? -1 : scope->stream_id();
+}
+
+void *TaskContext::State() {
+    TaskScope *scope = TaskScope::current();
+    return scope == nullptr ? nullptr : scope->node()->GetState(scope->stream_id());
+}
+
+void *TaskContext::ScratchAlloc(uint32_t size) {
+    if (TaskScope::current() == nullptr)
+        return nullptr;
+    return TaskScope::arena()->Alloc(size);
+}
+
+}  // end of namespace ecas.
@@ -0,0 +1,40 @@
+/*!
+* \brief TaskContext.
+*        记录当前线程正在处理的节点和帧信息，供Task内部通过TaskContext的静态接口获取。
+*/
+
+#ifndef ECAS_CORE_TASK_CONTEXT_HPP_
+#define ECAS_CORE_TASK_CONTEXT_HPP_
+
+#include "ecas/ecas.hpp"
+#include "util/scratch_arena.hpp"
+
+namespace ecas {
+
+class Node;
+
+// Set the context of the current thread in its lifetime, and restore the former one
+// at the end, since a composite node runs its inner nodes inside its own scope.
+// The scratch memory allocated in the scope is given back at the end of it.
+class TaskScope {
+public:
+    TaskScope(Node *node, int stream_id);
+    ~TaskScope();
+
+    static TaskScope *current();
+    // The scratch arena of the current thread.
+    static util::ScratchArena *arena();
+
+    inline Node *node() { return node_; }
+    inline int stream_id() const { return stream_id_; }
+
+private:
+    Node *node_;
+    int stream_id_;
+    TaskScope *prev_;
+    util::ScratchArena::Mark mark_;
+};
+
+}  // end of namespace ecas.
+
+#endif // ECAS_CORE_TASK_CONTEXT_HPP_
@@ -12,8 +12,38 @@
 
 namespace ecas {
 
+// The position of the index-th element in the logical order, in elements.
+static uint32_t StridedOffset(std::vector<int> &shape, std::vector<int> &strides, uint32_t index) {
+    uint32_t offset = 0;
+    for (int i = (int)shape.size() - 1; i >= 0; i--) {
+        offset += (index % shape[i]) * strides[i];
+        index /= shape[i];
+    }
+    return offset;
+}
+
+// Copy between two tensors of the same shape, row by row.
+static void CopyStrided(char *dst, std::vector<int> &dst_strides, char *src, std::vector<int> &src_strides,
+                        std::vector<int> &shape, uint32_t count, int elem_size) {
+    int cols = shape.empty() ? 1 : shape.back();
+    int dst_step = shape.empty() ? 1 : dst_strides.back();
+    int src_step = shape.empty() ? 1 : src_strides.back();
+    for (uint32_t r = 0; r < count / cols; r++) {
+        char *d = dst + StridedOffset(shape, dst_strides, r * cols) * elem_size;
+        char *s = src + StridedOffset(shape, src_strides, r * cols) * elem_size;
+        if (dst_step == 1 && src_step == 1) {
+            memcpy(d, s, cols * elem_size);
+            continue;
+        }
+        for (int j = 0; j < cols; j++)
+            memcpy(d + j * dst_step * elem_size, s + j * src_step * elem_size, elem_size);
+    }
+}
+
 Tensor::Tensor(std::vector<int> &shape, DataType type) {
     id_ = -1;
+    stream_id_ = -1;
+    priority_ = 0;
     shape_ = shape;
     type_ = type;
 
@@ -23,10 +53,19 @@ Tensor::Tensor(std::vector<int> &shape, DataType type) {
     }
     if (size_ == 0)
         std::abort();
+    strides_.resize(shape.size());
+    int stride = 1;
+    for (int i = (int)shape.size() - 1; i >= 0; i--) {
+        strides_[i] = stride;
+        stride *= shape[i];
+    }
     
     is_owned_buffer_ = false;
     buffer_ = nullptr;
+    is_view_ = false;
+    offset_ = 0;
     mode_ = ON_HOST;
+    ref_count_ = 0;
 }
 
 Tensor::~Tensor() {
@@ -53,6 +92,50 @@ void Tensor::BindBuffer(Buffer *buffer) {
     buffer_ = buffer;
 }
 
+uint32_t Tensor::ElementOffset(uint32_t index) {
+    return StridedOffset(shape_, strides_, index);
+}
+
+void Tensor::BindView(Tensor *parent, std::vector<int> &strides, uint32_t offset) {
+    if (parent->type() != type_)
+        ECAS_LOGE("Tensor::BindView -> type mismatch.\n");
+    if (strides.empty()) {
+        if (!parent->is_contiguous())
+            ECAS_LOGE("Tensor::BindView -> Only a contiguous tensor can be reshaped.\n");
+    }
+    else {
+        if (strides.size() != shape_.size())
+            ECAS_LOGE("Tensor::BindView -> %d strides for %d dimensions.\n", (int)strides.size(), (int)shape_.size());
+        for (int i = 0; i < strides.size(); i++) {
+            if (strides[i] < 0)
+                ECAS_LOGE("Tensor::BindView -> Negative stride %d.\n", strides[i]);
+        }
+        strides_ = strides;
+    }
+    // The last element should be inside the parent.
+    uint32_t elem_size = 0;
+    TYPE_SWITCH(type_, T, elem_size = sizeof(T););
+    uint64_t last = offset + ElementOffset(size_ / elem_size - 1);
+    uint64_t parent_last = parent->ElementOffset(parent->size() / elem_size - 1);
+    if (last > parent_last)
+        ECAS_LOGE("Tensor::BindView -> The view is out of the parent.\n");
+
+    buffer_ = parent->buffer_;
+    is_owned_buffer_ = false;
+    is_view_ = true;
+    offset_ = parent->offset_ + offset * elem_size;
+    mode_ = parent->mode_;
+}
+
+void Tensor::Fill(float value) {
+    bool is_contiguous = this->is_contiguous();
+    TYPE_SWITCH(type_, T, {
+        T *data = (T *)GetData();
+        for (uint32_t i = 0; i < size_ / sizeof(T); i++)
+            data[is_contiguous ? i : ElementOffset(i)] = (T)value;
+    });
+}
+
 void Tensor::CopyFrom(ITensor *in) {
     // Check dimension.
     CheckDimension(in);
@@ -61,7 +144,15 @@ void Tensor::CopyFrom(ITensor *in) {
         ECAS_LOGE("Tensor::CloneFrom -> memory type mismatch.\n");
     }
     id_ = in->id();
-    memcpy(GetData(), in->GetData(), size_);
+    stream_id_ = in->stream_id();
+    priority_ = in->priority();
+    if (is_contiguous() && in->is_contiguous()) {
+        memcpy(GetData(), in->GetData(), size_);
+        return;
+    }
+    uint32_t elem_size = 0;
+    TYPE_SWITCH(type_, T, elem_size = sizeof(T););
+    CopyStrided((char *)GetData(), strides_, (char *)in->GetData(), in->strides(), shape_, size_ / elem_size, elem_size);
 }
 
 void Tensor::CopyTo(ITensor *out) {
@@ -72,15 +163,26 @@ void Tensor::CopyTo(ITensor *out) {
         ECAS_LOGE("Tensor::CopyTo -> memory type mismatch.\n");
     }
     out->SetId(id_);
-    memcpy(out->GetData(), GetData(), size_);
+    out->SetStreamId(stream_id_);
+    out->SetPriority(priority_);
+    if (is_contiguous() && out->is_contiguous()) {
+        memcpy(out->GetData(), GetData(), size_);
+        return;
+    }
+    uint32_t elem_size = 0;
+    TYPE_SWITCH(type_, T, elem_size = sizeof(T););
+    CopyStrided((char *)out->GetData(), out->strides(), (char *)GetData(), strides_, shape_, size_ / elem_size, elem_size);
 }
 
 void Tensor::BindHostDataPtr(void *data) {
-    if (buffer_ == nullptr) {
-        ECAS_LOGE("Tensor::BindHostDataPtr -> buffer_ == nullptr.\n");
+    if (data == nullptr) {
+        ECAS_LOGE("Tensor::BindHostDataPtr -> data == nullptr.\n");
     }
 
     // 只能持有不含内存的host buffer，其他包含内存的buffer均不持有
+    // Release the one held by the previous binding.
+    if (is_owned_buffer_ == true && buffer_ != nullptr)
+        delete buffer_;
     is_owned_buffer_ = true; 
     buffer_ = new HostBuffer(size_, data);
 }
@@ -88,7 +190,7 @@ void Tensor::BindHostDataPtr(void *data) {
 void *Tensor::GetData(MemoryMode mode) {
     if (mode == ON_HOST) {
         if (mode_ == ON_HOST)
-            return buffer_->data();
+            return (char *)buffer_->data() + offset_;
         else {
             // TODO: push data from host to device.
 
@@ -97,7 +199,7 @@ void *Tensor::GetData(MemoryMode mode) {
     else {
         if (mode_ == ON_HOST) {
             // TODO: push data from device to host
-            return buffer_->data();
+            return (char *)buffer_->data() + offset_;
         }
         else {
 
@@ -117,6 +219,7 @@ void Tensor::Print() {
     memcpy(s + 4 - shape_.size(), &shape_[0], sizeof(uint32_t) * shape_.size());
 
     void *host_data = GetData(ON_HOST);
+    bool is_contiguous = this->is_contiguous();
     TYPE_SWITCH(type_, T, {
         T *data = (T *)host_data;
         for (int n = 0; n < s[0]; n++) {
@@ -127,7 +230,8 @@ void Tensor::Print() {
                 for (int h = 0; h < s[2]; h++) {
                     int h_bias = h * s[3];
                     for (int w = 0; w < s[3]; w++) {
-                        std::cout << data[n_bias + c_bias + h_bias + w] << ", ";
+                        int index = n_bias + c_bias + h_bias + w;
+                        std::cout << data[is_contiguous ? index : ElementOffset(index)] << ", ";
                     }
                 }
             }
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
 
 #include "buffer.hpp"
 #include "ecas/ecas.hpp"
@@ -28,9 +29,20 @@ public:
     ~Tensor();
 
     inline uint32_t size() { return size_; }
+    inline DataType type() const { return type_; }
+    inline Buffer *buffer() { return buffer_; }
+    inline bool is_view() const { return is_view_; }
+    // For the tensor shared by several consumers, see BlockingQueuePair::branches.
+    inline void SetRefCount(int count) { ref_count_.store(count); }
+    inline int Unref() { return --ref_count_; }
     void BindBuffer(Buffer *buffer);
+    // Share the buffer of parent from offset with strides, both in elements of the parent's memory.
+    // Empty strides: contiguous.
+    void BindView(Tensor *parent, std::vector<int> &strides, uint32_t offset);
     void CopyFrom(ITensor *in);
     void CopyTo(ITensor *out);
+    // Set all the elements to value.
+    void Fill(float value);
     
     // Use external memory.
     void BindHostDataPtr(void *data);
@@ -39,11 +51,16 @@ public:
 
 private:
     void CheckDimension(ITensor *target);
+    // The position in memory of the index-th element in the logical order, in elements.
+    uint32_t ElementOffset(uint32_t index);
 
 private:
     uint32_t size_;
     bool is_owned_buffer_; // 只能持有不含内存的host buffer(即由外部引入指针)，其他包含内存的buffer均不持有
     Buffer *buffer_;
+    bool is_view_;
+    uint32_t offset_; // In bytes, from the start of buffer_.
+    std::atomic<int> ref_count_;
 };
 
 }  // end of namespace ecas.
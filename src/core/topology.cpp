@@ -4,6 +4,11 @@
 */
 
 #include "topology.hpp"
+
+#include <stdlib.h>
+#include <queue>
+
+#include "node.hpp"
 #include "util/logger.hpp"
 
 namespace ecas {
@@ -12,6 +17,59 @@ Topology::Topology() {}
 
 Topology::~Topology() {}
 
+std::string Topology::ParseItem(const std::string &item, EdgeAttr *attr, bool *has_attr) {
+    *has_attr = false;
+    size_t pos = item.find('[');
+    if (pos == std::string::npos)
+        return item;
+    if (item.back() != ']')
+        ECAS_LOGE("Topology::ParseItem -> Missing ']' in %s.\n", item.c_str());
+
+    *has_attr = true;
+    std::string options = item.substr(pos + 1, item.size() - pos - 2);
+    size_t begin = 0;
+    while (begin < options.size()) {
+        size_t end = options.find(',', begin);
+        if (end == std::string::npos)
+            end = options.size();
+        std::string option = options.substr(begin, end - begin);
+        size_t eq = option.find('=');
+        std::string key = option.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+        if (key == "depth") {
+            if (value == "auto") {
+                attr->is_auto_depth = true;
+            }
+            else {
+                attr->depth = atoi(value.c_str());
+                if (attr->depth <= 0)
+                    ECAS_LOGE("Topology::ParseItem -> Invalid depth in %s.\n", item.c_str());
+            }
+        }
+        else if (key == "overflow") {
+            if (value == "block")
+                attr->overflow = OVERFLOW_BLOCK;
+            else if (value == "drop_oldest")
+                attr->overflow = DROP_OLDEST;
+            else if (value == "drop_newest")
+                attr->overflow = DROP_NEWEST;
+            else if (value == "latest")
+                attr->overflow = KEEP_LATEST;
+            else
+                ECAS_LOGE("Topology::ParseItem -> Invalid overflow in %s.\n", item.c_str());
+        }
+        else if (key == "delay") {
+            attr->is_delay = true;
+            attr->delay_value = value.empty() ? 0 : atof(value.c_str());
+        }
+        else {
+            ECAS_LOGE("Topology::ParseItem -> Unknown option %s in %s.\n", key.c_str(), item.c_str());
+        }
+        begin = end + 1;
+    }
+    return item.substr(0, pos);
+}
+
 void Topology::Build(std::map<std::string, Node*> &nodes, std::vector<std::vector<std::string>> &&relation) {
     // for (int i=0; i<relation.size(); i++) {
     //     for (int j=1; j<relation[i].size(); j++) {
@@ -19,6 +77,48 @@ void Topology::Build(std::map<std::string, Node*> &nodes, std::vector<std::vecto
     //     }
     // }
 
+    // Split the attributes from the names, and drop the reserved io items.
+    graph_inputs_.clear();
+    graph_outputs_.clear();
+    for (int i=0; i<relation.size(); i++) {
+        std::vector<std::string> names(relation[i].size());
+        std::vector<EdgeAttr> attrs(relation[i].size());
+        std::vector<bool> has_attrs(relation[i].size());
+        for (int j=0; j<relation[i].size(); j++) {
+            bool has_attr;
+            names[j] = ParseItem(relation[i][j], &attrs[j], &has_attr);
+            has_attrs[j] = has_attr;
+        }
+        std::vector<std::string> chain;
+        for (int j=0; j<names.size(); j++) {
+            if (IsGraphPort(names[j], "input")) {
+                if (j != 0 || names.size() < 2)
+                    ECAS_LOGE("Topology::Build -> \"%s\" should be followed by a node.\n", names[j].c_str());
+                if (has_attrs[j])
+                    edge_attrs_[std::make_pair(names[j], names[j+1])] = attrs[j];
+                graph_inputs_.push_back(std::make_pair(names[j], names[j+1]));
+                continue;
+            }
+            if (IsGraphPort(names[j], "output")) {
+                if (j == 0 || j != names.size() - 1)
+                    ECAS_LOGE("Topology::Build -> \"%s\" should be behind a node.\n", names[j].c_str());
+                if (has_attrs[j])
+                    edge_attrs_[std::make_pair(names[j-1], names[j])] = attrs[j];
+                graph_outputs_.push_back(std::make_pair(names[j], names[j-1]));
+                continue;
+            }
+            if (attrs[j].is_delay && attrs[j].overflow != OVERFLOW_BLOCK)
+                ECAS_LOGE("Topology::Build -> The delay edge to %s can not drop frames.\n", names[j].c_str());
+            if (has_attrs[j]) {
+                if (j == 0)
+                    ECAS_LOGE("Topology::Build -> %s has no front node for its attributes.\n", relation[i][j].c_str());
+                edge_attrs_[std::make_pair(names[j-1], names[j])] = attrs[j];
+            }
+            chain.push_back(names[j]);
+        }
+        relation[i].swap(chain);
+    }
+
     for (int i=0; i<relation.size(); i++) {
         for (int j=1; j<relation[i].size(); j++) {
             std::map<std::string, Node*>::iterator nodes_iter;
@@ -61,6 +161,72 @@ void Topology::Build(std::map<std::string, Node*> &nodes, std::vector<std::vecto
             }
         }
     }
+    CheckCycles();
+}
+
+void Topology::CheckCycles() {
+    std::map<Node*, int> in_degree;
+    std::map<Node*, std::vector<Node*>>::iterator iter;
+    for (iter = output_map_.begin(); iter != output_map_.end(); iter++) {
+        in_degree[iter->first];
+        for (int i = 0; i < iter->second.size(); i++) {
+            if (!IsDelayEdge(iter->first, iter->second[i]))
+                in_degree[iter->second[i]]++;
+            else
+                in_degree[iter->second[i]];
+        }
+    }
+    std::queue<Node*> ready;
+    for (std::map<Node*, int>::iterator it = in_degree.begin(); it != in_degree.end(); it++) {
+        if (it->second == 0)
+            ready.push(it->first);
+    }
+    int num_sorted = 0;
+    while (!ready.empty()) {
+        Node *n = ready.front();
+        ready.pop();
+        num_sorted++;
+        std::vector<Node*> *outs = GetOutputs(n);
+        if (outs == nullptr) continue;
+        for (int i = 0; i < outs->size(); i++) {
+            if (!IsDelayEdge(n, (*outs)[i]) && --in_degree[(*outs)[i]] == 0)
+                ready.push((*outs)[i]);
+        }
+    }
+    if (num_sorted == in_degree.size())
+        return;
+    std::string names;
+    for (std::map<Node*, int>::iterator it = in_degree.begin(); it != in_degree.end(); it++) {
+        if (it->second > 0)
+            names += " " + it->first->name();
+    }
+    ECAS_LOGE("Topology::CheckCycles -> Cycle found in [%s ], mark one edge of it with delay.\n", names.c_str());
+}
+
+bool Topology::IsGraphPort(const std::string &name, const std::string &prefix) {
+    if (name.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    return name.size() == prefix.size() || name[prefix.size()] == ':';
+}
+
+bool Topology::IsDelayEdge(Node *front, Node *rear) {
+    return GetEdgeAttr(front->name(), rear->name()).is_delay;
+}
+
+int Topology::NumForwardInputs(Node *node) {
+    std::vector<Node*> *ins = GetInputs(node);
+    int num = 0;
+    for (int i = 0; ins != nullptr && i < ins->size(); i++)
+        num += IsDelayEdge((*ins)[i], node) ? 0 : 1;
+    return num;
+}
+
+int Topology::NumForwardOutputs(Node *node) {
+    std::vector<Node*> *outs = GetOutputs(node);
+    int num = 0;
+    for (int i = 0; outs != nullptr && i < outs->size(); i++)
+        num += IsDelayEdge(node, (*outs)[i]) ? 0 : 1;
+    return num;
 }
 
 std::vector<Node*> *Topology::GetOutputs(Node *node) {
@@ -72,6 +238,15 @@ std::vector<Node*> *Topology::GetOutputs(Node *node) {
         return nullptr;
 }
 
+EdgeAttr Topology::GetEdgeAttr(const std::string &front, const std::string &rear) {
+    std::map<std::pair<std::string, std::string>, EdgeAttr>::iterator iter;
+    iter = edge_attrs_.find(std::make_pair(front, rear));
+    if (iter != edge_attrs_.end())
+        return iter->second;
+    else
+        return EdgeAttr();
+}
+
 std::vector<Node*> *Topology::GetInputs(Node *node) {
     std::map<Node*, std::vector<Node*>>::iterator io_iter;
     io_iter = input_map_.find(node);
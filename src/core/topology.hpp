@@ -9,10 +9,28 @@
 #include <vector>
 #include <map>
 
+#include "ecas/ecas.hpp"
+
 namespace ecas {
 
 class Node;
 
+// The attributes of the edge, written after the rear node in relation, like "n2[depth=4]"
+// or "n2[depth=2,overflow=drop_oldest]".
+// "input" and "output" are reserved to attach attributes to the graph io edges,
+// such as {"input[depth=2]", "n1", "n2", "output[depth=auto]"}, and to name the graph
+// ports, such as {"input:audio", "a1", "fuse", "output:score"}.
+// "delay" or "delay=v" marks a feedback edge, like {"n3", "n2[delay=0]"}: it starts with
+// one slot of value v, so the input of frame t is the output of frame t-1. The delay
+// edges are left out when sorting the nodes, and each cycle should have one of them.
+struct EdgeAttr {
+    int depth = 0;              // Number of slots of the BlockingQueuePair, <= 0 means the default.
+    bool is_auto_depth = false; // Tune the depth at runtime, see Allocator::TuneBlockingQueue.
+    OverflowPolicy overflow = OVERFLOW_BLOCK;
+    bool is_delay = false;
+    float delay_value = 0;      // The initial value of the delay edge.
+};
+
 class Topology {    
 public:
     Topology();
@@ -21,13 +39,34 @@ public:
 
     std::vector<Node*> *GetOutputs(Node *node);
     std::vector<Node*> *GetInputs(Node *node);
+    // Returns the default attributes if not set.
+    EdgeAttr GetEdgeAttr(const std::string &front, const std::string &rear);
+    bool IsDelayEdge(Node *front, Node *rear);
+    // The number of the inputs / outputs of the node that are not delay edges.
+    int NumForwardInputs(Node *node);
+    int NumForwardOutputs(Node *node);
+    // <port name, node name> of the graph ports named in relation, in the order of relation.
+    inline std::vector<std::pair<std::string, std::string>> &graph_inputs() { return graph_inputs_; }
+    inline std::vector<std::pair<std::string, std::string>> &graph_outputs() { return graph_outputs_; }
+    // "input" or "input:NAME" for prefix "input".
+    static bool IsGraphPort(const std::string &name, const std::string &prefix);
 
     void Show();
 
 private:
+    // "n2[depth=4]" -> name "n2" and the attributes.
+    std::string ParseItem(const std::string &item, EdgeAttr *attr, bool *has_attr);
+    // Kahn's algorithm without the delay edges.
+    void CheckCycles();
+
+private:
+    // <<front, rear>, attributes>
+    std::map<std::pair<std::string, std::string>, EdgeAttr> edge_attrs_;
     // <target, the outputs/inputs of the target>
     std::map<Node*, std::vector<Node*>> output_map_;
     std::map<Node*, std::vector<Node*>> input_map_;
+    std::vector<std::pair<std::string, std::string>> graph_inputs_;
+    std::vector<std::pair<std::string, std::string>> graph_outputs_;
 };
 
 }  // end of namespace ecas.
@@ -0,0 +1,179 @@
+/*!
+* \brief WorkerPool.
+*/
+
+#include "worker_pool.hpp"
+
+#include "util/logger.hpp"
+#include "util/thread_attr.hpp"
+#include "util/timer.hpp"
+
+namespace ecas {
+
+WorkerPool::WorkerPool() {
+    is_stealing_ = true;
+    profiler_ = nullptr;
+    num_tasks_ = 0;
+    is_stop_ = false;
+}
+
+WorkerPool::~WorkerPool() {
+    Stop();
+    Join();
+}
+
+void WorkerPool::Start(int num_worker, bool is_stealing, void *usr,
+                       const std::vector<GroupAttr> &attrs) {
+    if (is_started()) {
+        ECAS_LOGE("WorkerPool::Start -> The pool has been started.\n");
+        return;
+    }
+    if (num_worker <= 0) {
+        num_worker = std::thread::hardware_concurrency();
+        if (num_worker <= 0) num_worker = 1;
+    }
+
+    is_stop_ = false;
+    is_stealing_ = is_stealing;
+    for (int i = 0; i < num_worker; i++)
+        workers_.push_back(new Worker);
+    // Start the threads after all the workers exist, they will steal from each other.
+    for (int i = 0; i < num_worker; i++) {
+        GroupAttr attr;
+        if (i < attrs.size())
+            attr = attrs[i];
+        workers_[i]->thread = std::thread(&WorkerPool::Entry, this, i, usr, attr);
+    }
+}
+
+void WorkerPool::Submit(Node *node) {
+    if (!is_started())
+        return;
+
+    node->MarkDirty();
+    bool is_urgent = node->HasUrgentInput();
+    Worker *w = workers_[node->group_id() % workers_.size()];
+    {
+        std::unique_lock<std::mutex> lock(w->mutex);
+        if (is_urgent)
+            w->urgent_tasks.push_back(node);
+        else
+            w->tasks.push_back(node);
+    }
+    num_tasks_++;
+    // Take the lock so that a worker between checking and waiting can not miss it.
+    { std::unique_lock<std::mutex> lock(mutex_); }
+    if (is_stealing_)
+        cond_var_.notify_one();
+    else
+        cond_var_.notify_all();
+}
+
+void WorkerPool::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        is_stop_ = true;
+    }
+    cond_var_.notify_all();
+}
+
+void WorkerPool::Join() {
+    for (int i = 0; i < workers_.size(); i++) {
+        if (workers_[i]->thread.joinable())
+            workers_[i]->thread.join();
+        delete workers_[i];
+    }
+    workers_.clear();
+    num_tasks_ = 0;
+}
+
+bool WorkerPool::HasTask(int wid) {
+    if (is_stealing_)
+        return num_tasks_ > 0;
+
+    std::unique_lock<std::mutex> lock(workers_[wid]->mutex);
+    return !workers_[wid]->tasks.empty() || !workers_[wid]->urgent_tasks.empty();
+}
+
+bool WorkerPool::PopTask(int wid, Node **node) {
+    // The urgent ones first, including those of the others.
+    return PopTask(wid, true, node) || PopTask(wid, false, node);
+}
+
+bool WorkerPool::PopTask(int wid, bool is_urgent, Node **node) {
+    // Take the newest one from its own queue.
+    Worker *w = workers_[wid];
+    {
+        std::unique_lock<std::mutex> lock(w->mutex);
+        std::deque<Node *> &tasks = is_urgent ? w->urgent_tasks : w->tasks;
+        if (!tasks.empty()) {
+            *node = tasks.back();
+            tasks.pop_back();
+            num_tasks_--;
+            return true;
+        }
+    }
+    if (!is_stealing_)
+        return false;
+    // Steal the oldest one from the others.
+    for (int i = 1; i < workers_.size(); i++) {
+        Worker *victim = workers_[(wid + i) % workers_.size()];
+        std::unique_lock<std::mutex> lock(victim->mutex);
+        std::deque<Node *> &tasks = is_urgent ? victim->urgent_tasks : victim->tasks;
+        if (!tasks.empty()) {
+            *node = tasks.front();
+            tasks.pop_front();
+            num_tasks_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::Execute(Node *node, void *usr, int wid) {
+    IoContext ctx;
+    // If the node is held by another worker, the holder will see the dirty flag.
+    while (node->TryClaim()) {
+        node->ClearDirty();
+        while (!is_stop_ && node->BorrowIo(&ctx)) {
+            // Let another worker run a replica on the rest of the data.
+            if (node->num_replica() > 1 && node->CheckIoIsReady())
+                Submit(node);
+            if (profiler_ == nullptr) {
+                node->Invoke(usr, ctx.inputs, ctx.outputs);
+                node->RecycleIo(&ctx);
+                continue;
+            }
+            int64_t start = util::NowNs();
+            profiler_->RecordWait(node, start);
+            node->Invoke(usr, ctx.inputs, ctx.outputs);
+            int64_t end = util::NowNs();
+            // The inputs may be refilled by the producers once recycled.
+            int id = ctx.inputs.empty() ? -1 : ctx.inputs[0]->id();
+            node->RecycleIo(&ctx);
+            profiler_->RecordRun(node, wid, id, start, end);
+        }
+        node->Unclaim();
+        // Submitted again while it was claimed.
+        if (!node->ClearDirty())
+            break;
+    }
+}
+
+void WorkerPool::Entry(int wid, void *usr, GroupAttr attr) {
+    util::ThreadAttr::BindCores(attr.cpus);
+    util::ThreadAttr::SetPriority(attr.priority, attr.nice);
+
+    while (!is_stop_) {
+        Node *node;
+        if (PopTask(wid, &node)) {
+            Execute(node, usr, wid);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_var_.wait(lock, [this, wid] { return is_stop_ || HasTask(wid); });
+    }
+    ECAS_LOGI("WorkerPool: worker %d exit.\n", wid);
+}
+
+}  // end of namespace ecas.
@@ -0,0 +1,71 @@
+/*!
+* \brief WorkerPool.
+*        工作线程池，每个线程持有自己的任务队列，可选择空闲时从其他线程窃取任务。
+*        任务即节点，节点的所有端口就绪时由Node::OnPortChanged通知提交。
+*        持有紧急帧的节点优先执行。
+*/
+
+#ifndef ECAS_CORE_WORKER_POOL_HPP_
+#define ECAS_CORE_WORKER_POOL_HPP_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "node.hpp"
+#include "profiler.hpp"
+
+namespace ecas {
+
+class WorkerPool {
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    inline int num_worker() const { return workers_.size(); }
+    inline bool is_started() const { return !workers_.empty(); }
+
+    // Without stealing, each worker only runs the nodes whose group id equals to its index.
+    // attrs[i] will be applied to worker i when it starts, it can be shorter than num_worker.
+    void Start(int num_worker, bool is_stealing, void *usr,
+               const std::vector<GroupAttr> &attrs = std::vector<GroupAttr>());
+    // Tell the pool that the node may be runnable. The node is queued to the
+    // worker given by its group id, other idle workers can steal it if allowed.
+    // The nodes with urgent frames are taken before the others, see Node::HasUrgentInput.
+    void Submit(Node *node);
+    void Stop();
+    void Join();
+    // nullptr to disable. Set it before Start.
+    inline void SetProfiler(Profiler *profiler) { profiler_ = profiler; }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Node *> tasks;
+        std::deque<Node *> urgent_tasks;
+        std::thread thread;
+    };
+
+    bool HasTask(int wid);
+    bool PopTask(int wid, Node **node);
+    bool PopTask(int wid, bool is_urgent, Node **node);
+    void Execute(Node *node, void *usr, int wid);
+    void Entry(int wid, void *usr, GroupAttr attr);
+
+private:
+    std::vector<Worker *> workers_;
+    bool is_stealing_;
+    Profiler *profiler_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
+    std::atomic<int> num_tasks_;
+    std::atomic<bool> is_stop_;
+};
+
+}  // end of namespace ecas.
+
+#endif // ECAS_CORE_WORKER_POOL_HPP_
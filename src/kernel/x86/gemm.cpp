@@ -12,7 +12,10 @@ void Gemm(const int M, const int N, const int K,
 		  float *C, const int ldc) {
 	printf("gemm v1.\n");
 	int i, j, k;
-	memset(C, 0, sizeof(float) * ldc * M);
+	// Leave the gap between the rows of C untouched.
+	for (i = 0; i < M; ++i) {
+		memset(C + i * ldc, 0, sizeof(float) * N);
+	}
 	for (i = 0; i < M; ++i) {
 		for (k = 0; k < K; ++k) {
 			register float A_PART = ALPHA * A[i * lda + k];
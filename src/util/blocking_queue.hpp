@@ -19,8 +19,8 @@ public:
     bool try_pop(T* t);
     bool wait_and_pop(T* t);
 
-    inline bool empty() const { return queue_.empty(); }
-    inline int size() const { return queue_.size(); }
+    inline bool empty() const { std::unique_lock <std::mutex> lock(mutex_); return queue_.empty(); }
+    inline int size() const { std::unique_lock <std::mutex> lock(mutex_); return queue_.size(); }
     inline void exit() { is_exit_ = true; cond_var_.notify_all(); }
 
 private:
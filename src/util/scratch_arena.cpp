@@ -0,0 +1,78 @@
+/*!
+* \brief ScratchArena.
+*/
+
+#include "scratch_arena.hpp"
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include "logger.hpp"
+
+namespace ecas {
+namespace util {
+
+static void FreeChunk(char *chunk) {
+#if defined(_WIN32)
+    _aligned_free(chunk);
+#else
+    free(chunk);
+#endif
+}
+
+ScratchArena::ScratchArena() : curr_(0), offset_(0), capacity_(0) {}
+
+ScratchArena::~ScratchArena() {
+    for (int i = 0; i < chunks_.size(); i++)
+        FreeChunk(chunks_[i]);
+}
+
+void ScratchArena::AddChunk(uint64_t size) {
+    void *ptr = nullptr;
+#if defined(_WIN32)
+    ptr = _aligned_malloc(size, ECAS_SCRATCH_ALIGNMENT);
+#else
+    if (posix_memalign(&ptr, ECAS_SCRATCH_ALIGNMENT, size) != 0)
+        ptr = nullptr;
+#endif
+    if (ptr == nullptr)
+        ECAS_LOGE("ScratchArena::AddChunk -> Failed to allocate %llu bytes.\n", (unsigned long long)size);
+    chunks_.push_back((char *)ptr);
+    sizes_.push_back(size);
+    capacity_ += size;
+}
+
+void *ScratchArena::Alloc(uint32_t size) {
+    uint32_t aligned = (size + ECAS_SCRATCH_ALIGNMENT - 1) & ~(ECAS_SCRATCH_ALIGNMENT - 1);
+    // Move on to the next chunk large enough, the skipped ones stay idle until the reset.
+    while (curr_ < chunks_.size() && offset_ + aligned > sizes_[curr_]) {
+        curr_++;
+        offset_ = 0;
+    }
+    if (curr_ == chunks_.size()) {
+        uint64_t last = sizes_.empty() ? 0 : sizes_.back();
+        AddChunk(std::max<uint64_t>(std::max<uint64_t>(aligned, last * 2), ECAS_SCRATCH_MIN_CHUNK));
+        offset_ = 0;
+    }
+    void *ptr = chunks_[curr_] + offset_;
+    offset_ += aligned;
+    return ptr;
+}
+
+void ScratchArena::Reset(const Mark &mark) {
+    curr_ = mark.chunk;
+    offset_ = mark.offset;
+    if (curr_ != 0 || offset_ != 0 || chunks_.size() <= 1)
+        return;
+    // Back to the start with more than one chunk, merge them for the next round.
+    uint64_t total = capacity_;
+    for (int i = 0; i < chunks_.size(); i++)
+        FreeChunk(chunks_[i]);
+    chunks_.clear();
+    sizes_.clear();
+    capacity_ = 0;
+    AddChunk(total);
+}
+
+} // util.
+} // ecas.
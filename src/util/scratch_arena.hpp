@@ -0,0 +1,50 @@
+/*!
+* \brief ScratchArena.
+*        按块分配的线性(bump pointer)临时内存，只能整体回退到某个标记处，不能单独释放。
+*        回退到起点时把多个块合并成一个，稳定后不再有堆上的分配。
+*/
+
+#ifndef ECAS_UTIL_SCRATCH_ARENA_HPP_
+#define ECAS_UTIL_SCRATCH_ARENA_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+namespace ecas {
+namespace util {
+
+#define ECAS_SCRATCH_ALIGNMENT 64
+#define ECAS_SCRATCH_MIN_CHUNK (64 << 10)
+
+class ScratchArena {
+public:
+    struct Mark {
+        int chunk;
+        uint32_t offset;
+    };
+
+    ScratchArena();
+    ~ScratchArena();
+
+    // The memory is aligned to ECAS_SCRATCH_ALIGNMENT, and not initialized.
+    void *Alloc(uint32_t size);
+    inline Mark GetMark() const { return { curr_, offset_ }; }
+    // Everything allocated after the mark is given back.
+    void Reset(const Mark &mark);
+
+    inline uint64_t capacity() const { return capacity_; }
+
+private:
+    void AddChunk(uint64_t size);
+
+private:
+    std::vector<char *> chunks_;
+    std::vector<uint64_t> sizes_;
+    int curr_;
+    uint32_t offset_;
+    uint64_t capacity_;
+};
+
+} // util.
+} // ecas.
+#endif //ECAS_UTIL_SCRATCH_ARENA_HPP_
@@ -0,0 +1,251 @@
+/*!
+* \brief SpscQueue.
+*        有界无锁单生产者单消费者环形队列，接口与BlockingQueue一致。
+*        等待时先自旋，再让出，最后在futex上休眠。
+*        多生产者或多消费者时可分别开启对应一侧的互斥锁，另一侧仍保持无锁。
+*        分普通和紧急两条通道，默认先出紧急通道的数据。
+*/
+
+#ifndef ECAS_UTIL_SPSC_QUEUE_HPP_
+#define ECAS_UTIL_SPSC_QUEUE_HPP_
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ecas {
+namespace util {
+
+#define ECAS_CACHE_LINE_SIZE 64
+#define ECAS_SPSC_MIN_SPIN 16
+#define ECAS_SPSC_MAX_SPIN 4096
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Sleep while *addr == val, may wake up spuriously.
+inline void FutexWait(std::atomic<int> *addr, int val) {
+#if defined(__linux__)
+    syscall(SYS_futex, (int *)addr, FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+#else
+    if (addr->load() == val)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+}
+
+inline void FutexWakeAll(std::atomic<int> *addr) {
+#if defined(__linux__)
+    syscall(SYS_futex, (int *)addr, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+template <typename T>
+class SpscQueue {
+public:
+    SpscQueue(int capacity = 16) : is_exit_(false), is_multi_producer_(false), is_multi_consumer_(false),
+                                   spin_limit_(256), seq_(0), num_waiters_(0) { Reserve(capacity); };
+    ~SpscQueue() {};
+
+    // Call it before use. The capacity of each lane is rounded up to a power of 2.
+    void Reserve(int capacity);
+    // Serialize the pushes / pops with a mutex, for more than one producer / consumer.
+    inline void SetMultiProducer(bool enable) { is_multi_producer_ = enable; }
+    inline void SetMultiConsumer(bool enable) { is_multi_consumer_ = enable; }
+
+    // Producer side. It waits for space if the lane is full.
+    void push(const T& t, bool is_urgent = false);
+    // Consumer side. The other lane is taken if the first one is empty.
+    bool try_front(T* t, bool is_urgent_first = true);
+    bool try_pop(T* t, bool is_urgent_first = true);
+    bool wait_and_pop(T* t, bool is_urgent_first = true);
+    // The head of the lane only.
+    bool try_front_lane(T* t, bool is_urgent);
+
+    inline int capacity() const { return lanes_[0].buffer.size(); }
+    inline bool empty() const { return size() == 0; }
+    inline int size() const { return lanes_[0].size() + lanes_[1].size(); }
+    inline int size(bool is_urgent) const { return lanes_[is_urgent].size(); }
+    void exit();
+
+private:
+    struct Lane {
+        std::vector<T> buffer;
+        // The head is written by the consumer and the tail by the producer,
+        // keep them on different cache lines to avoid false sharing.
+        char pad0[ECAS_CACHE_LINE_SIZE];
+        std::atomic<uint32_t> head;
+        char pad1[ECAS_CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+        std::atomic<uint32_t> tail;
+        char pad2[ECAS_CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+
+        Lane() : head(0), tail(0) {}
+        inline int size() const { return (int)(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)); }
+    };
+    bool TryFrontImpl(T* t, bool is_urgent);
+    bool TryPopImpl(T* t, bool is_urgent);
+    void Wake();
+
+private:
+    std::atomic<bool> is_exit_;
+    bool is_multi_producer_;
+    bool is_multi_consumer_;
+    std::mutex producer_mutex_;
+    std::mutex consumer_mutex_;
+    uint32_t mask_;
+    std::atomic<int> spin_limit_;
+
+    // Futex word, increased by each push, the waiters sleep on it.
+    std::atomic<int> seq_;
+    std::atomic<int> num_waiters_;
+
+    // 0: normal, 1: urgent.
+    Lane lanes_[2];
+};
+
+template <typename T>
+void SpscQueue<T>::Reserve(int capacity) {
+    uint32_t size = 1;
+    while (size < (uint32_t)capacity)
+        size <<= 1;
+    mask_ = size - 1;
+    for (int i = 0; i < 2; i++) {
+        lanes_[i].buffer.resize(size);
+        lanes_[i].head = 0;
+        lanes_[i].tail = 0;
+    }
+}
+
+template <typename T>
+void SpscQueue<T>::Wake() {
+    seq_.fetch_add(1);
+    if (num_waiters_.load() > 0)
+        FutexWakeAll(&seq_);
+}
+
+template <typename T>
+void SpscQueue<T>::push(const T& t, bool is_urgent) {
+    std::unique_lock<std::mutex> lock(producer_mutex_, std::defer_lock);
+    if (is_multi_producer_)
+        lock.lock();
+
+    Lane &lane = lanes_[is_urgent];
+    uint32_t tail = lane.tail.load(std::memory_order_relaxed);
+    // The slots are bounded by the users, so it rarely waits here.
+    while (tail - lane.head.load(std::memory_order_acquire) > mask_) {
+        if (is_exit_) return;
+        std::this_thread::yield();
+    }
+    lane.buffer[tail & mask_] = t;
+    lane.tail.store(tail + 1, std::memory_order_release);
+    Wake();
+}
+
+template <typename T>
+bool SpscQueue<T>::TryFrontImpl(T* t, bool is_urgent) {
+    Lane &lane = lanes_[is_urgent];
+    uint32_t head = lane.head.load(std::memory_order_relaxed);
+    if (head == lane.tail.load(std::memory_order_acquire))
+        return false;
+    *t = lane.buffer[head & mask_];
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPopImpl(T* t, bool is_urgent) {
+    Lane &lane = lanes_[is_urgent];
+    uint32_t head = lane.head.load(std::memory_order_relaxed);
+    if (head == lane.tail.load(std::memory_order_acquire))
+        return false;
+    *t = lane.buffer[head & mask_];
+    lane.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::try_front(T* t, bool is_urgent_first) {
+    std::unique_lock<std::mutex> lock(consumer_mutex_, std::defer_lock);
+    if (is_multi_consumer_)
+        lock.lock();
+    return TryFrontImpl(t, is_urgent_first) || TryFrontImpl(t, !is_urgent_first);
+}
+
+template <typename T>
+bool SpscQueue<T>::try_front_lane(T* t, bool is_urgent) {
+    std::unique_lock<std::mutex> lock(consumer_mutex_, std::defer_lock);
+    if (is_multi_consumer_)
+        lock.lock();
+    return TryFrontImpl(t, is_urgent);
+}
+
+template <typename T>
+bool SpscQueue<T>::try_pop(T* t, bool is_urgent_first) {
+    std::unique_lock<std::mutex> lock(consumer_mutex_, std::defer_lock);
+    if (is_multi_consumer_)
+        lock.lock();
+    return TryPopImpl(t, is_urgent_first) || TryPopImpl(t, !is_urgent_first);
+}
+
+template <typename T>
+bool SpscQueue<T>::wait_and_pop(T* t, bool is_urgent_first) {
+    // Spin first, the data usually arrives soon in a pipeline. The spin limit adapts
+    // to whether spinning paid off recently, and spinning is useless on a single core.
+    static const bool is_multi_core = std::thread::hardware_concurrency() > 1;
+    int spin_limit = is_multi_core ? spin_limit_.load(std::memory_order_relaxed) : 0;
+    for (int i = 0; i < spin_limit; i++) {
+        if (is_exit_) return false;
+        if (try_pop(t, is_urgent_first)) {
+            if (spin_limit < ECAS_SPSC_MAX_SPIN)
+                spin_limit_.store(spin_limit * 2, std::memory_order_relaxed);
+            return true;
+        }
+        CpuRelax();
+    }
+    if (spin_limit > ECAS_SPSC_MIN_SPIN)
+        spin_limit_.store(spin_limit / 2, std::memory_order_relaxed);
+    for (int i = 0; i < 4; i++) {
+        if (is_exit_) return false;
+        if (try_pop(t, is_urgent_first)) return true;
+        std::this_thread::yield();
+    }
+    // Then sleep until the next push.
+    while (true) {
+        num_waiters_.fetch_add(1);
+        int seq = seq_.load();
+        if (is_exit_) {
+            num_waiters_.fetch_sub(1);
+            return false;
+        }
+        if (try_pop(t, is_urgent_first)) {
+            num_waiters_.fetch_sub(1);
+            return true;
+        }
+        FutexWait(&seq_, seq);
+        num_waiters_.fetch_sub(1);
+    }
+}
+
+template <typename T>
+void SpscQueue<T>::exit() {
+    is_exit_ = true;
+    seq_.fetch_add(1);
+    FutexWakeAll(&seq_);
+}
+
+} // namespace util
+} // namespace ecas
+
+#endif // ECAS_UTIL_SPSC_QUEUE_HPP_
@@ -0,0 +1,81 @@
+/*!
+* \brief Thread attributes.
+*/
+
+#include "thread_attr.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include "logger.hpp"
+
+namespace ecas {
+namespace util {
+
+bool ThreadAttr::BindCores(const std::vector<int> &cpus) {
+    if (cpus.empty())
+        return true;
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int i = 0; i < cpus.size(); i++) {
+        // CPU_SET does not check the range.
+        if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+            ECAS_LOGW("ThreadAttr::BindCores -> Invalid cpu id %d.\n", cpus[i]);
+            return false;
+        }
+        CPU_SET(cpus[i], &mask);
+    }
+#if defined(__ANDROID__)
+    int ret = sched_setaffinity(0, sizeof(mask), &mask); // 0: the calling thread.
+    if (ret != 0) ret = errno;
+#else
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+#endif
+    if (ret != 0) {
+        ECAS_LOGW("ThreadAttr::BindCores -> failed: %s.\n", strerror(ret));
+        return false;
+    }
+    return true;
+#else
+    ECAS_LOGW("ThreadAttr::BindCores -> Not supported on this platform.\n");
+    return false;
+#endif
+}
+
+bool ThreadAttr::SetPriority(int priority, int nice) {
+#if defined(__linux__)
+    if (priority > 0) {
+        sched_param param;
+        param.sched_priority = priority;
+        int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (ret != 0) {
+            ECAS_LOGW("ThreadAttr::SetPriority -> SCHED_FIFO(%d) failed: %s.\n", priority, strerror(ret));
+            return false;
+        }
+    }
+    else if (nice != 0) {
+        // On linux, the nice value is a per-thread attribute when given the tid.
+        pid_t tid = syscall(SYS_gettid);
+        if (setpriority(PRIO_PROCESS, tid, nice) != 0) {
+            ECAS_LOGW("ThreadAttr::SetPriority -> nice(%d) failed: %s.\n", nice, strerror(errno));
+            return false;
+        }
+    }
+    return true;
+#else
+    if (priority > 0 || nice != 0)
+        ECAS_LOGW("ThreadAttr::SetPriority -> Not supported on this platform.\n");
+    return false;
+#endif
+}
+
+} // util.
+} // ecas.
@@ -0,0 +1,25 @@
+/*!
+* \brief Thread attributes.
+*        绑核与线程优先级设置，作用于调用线程。
+*/
+
+#ifndef ECAS_UTIL_THREAD_ATTR_HPP_
+#define ECAS_UTIL_THREAD_ATTR_HPP_
+
+#include <vector>
+
+namespace ecas {
+namespace util {
+
+class ThreadAttr {
+public:
+    // Bind the calling thread to the cores.
+    static bool BindCores(const std::vector<int> &cpus);
+    // priority > 0: SCHED_FIFO with the priority, needs CAP_SYS_NICE or root.
+    // Otherwise set the nice value of the calling thread if it is not 0.
+    static bool SetPriority(int priority, int nice);
+};
+
+} // util.
+} // ecas.
+#endif //ECAS_UTIL_THREAD_ATTR_HPP_
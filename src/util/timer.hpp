@@ -5,12 +5,19 @@
 #ifndef ECAS_UTIL_TIMER_HPP_
 #define ECAS_UTIL_TIMER_HPP_
 
+#include <stdint.h>
 #include <iostream>
 #include <chrono>
 
 namespace ecas {
 namespace util {
 
+// Monotonic timestamp in nanoseconds, for the statistics and the trace.
+inline int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // Timer for cpu.
 class CpuTimer {
 public:
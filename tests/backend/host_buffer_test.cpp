@@ -0,0 +1,38 @@
+/*!
+* \brief . 
+*/
+
+#include "backend/buffer/host_buffer.hpp"
+#include "core/allocator.hpp"
+#include "core/tensor.hpp"
+
+#include <stdint.h>
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+TEST(OpTest, HostBufferAlignment) {
+    for (int i = 1; i < 100; i += 17) {
+        HostBuffer buffer(i * 100, 256);
+        EXPECT_EQ((uintptr_t)buffer.data() % 256, 0);
+        EXPECT_EQ(((char *)buffer.data())[i * 100 - 1], 0);
+    }
+    Allocator allocator;
+    std::vector<int> shape = {3};
+    Tensor *t = allocator.CreateTensor(shape, FP32, nullptr);
+    EXPECT_EQ((uintptr_t)t->GetData() % 64, 0);
+
+    // Huge pages or not, the buffer is aligned, zeroed and writable.
+    uint32_t size = ECAS_HUGE_PAGE_SIZE + 100;
+    HostBuffer huge(size, 64, true);
+    char *data = (char *)huge.data();
+    EXPECT_EQ((uintptr_t)data % 64, 0);
+    EXPECT_EQ(data[0], 0);
+    EXPECT_EQ(data[size - 1], 0);
+    data[size - 1] = 1;
+    EXPECT_EQ(data[size - 1], 1);
+}
+
+}  // end of namespace.
@@ -0,0 +1,46 @@
+/*!
+* \brief . 
+*/
+
+#include "ecas/ecas.hpp"
+
+#include <stdio.h>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+TEST(OpTest, MappedTensor) {
+    // A header of 4100 bytes, not aligned to the page, then 1000 floats.
+    std::string path = "mapped_tensor_test.bin";
+    FILE *fp = fopen(path.c_str(), "wb");
+    ASSERT_NE(fp, nullptr);
+    std::vector<char> header(4100, 0);
+    std::vector<float> weights(1000);
+    for (int i = 0; i < weights.size(); i++)
+        weights[i] = i * 0.5f;
+    fwrite(header.data(), 1, header.size(), fp);
+    fwrite(weights.data(), sizeof(float), weights.size(), fp);
+    fclose(fp);
+
+    SessionConfig config;
+    config.mode = SERIAL;
+    Session *s0 = new Session("mapped0", config);
+    Session *s1 = new Session("mapped1", config);
+    ITensor *t0 = s0->CreateMappedITensor(path, header.size(), {10, 100}, FP32);
+    ITensor *t1 = s1->CreateMappedITensor(path, header.size(), {10, 100}, FP32, PREFETCH_POPULATE);
+    ITensor *t2 = s1->CreateMappedITensor(path, header.size() + 400, {10}, FP32, PREFETCH_ASYNC);
+    for (int i = 0; i < weights.size(); i++) {
+        EXPECT_EQ(((float *)t0->GetData())[i], weights[i]);
+        EXPECT_EQ(((float *)t1->GetData())[i], weights[i]);
+    }
+    EXPECT_EQ(((float *)t2->GetData())[0], weights[100]);
+    s1->ReleaseITensor(t2);
+    delete s0;
+    delete s1;
+    remove(path.c_str());
+}
+
+}  // end of namespace.
@@ -0,0 +1,836 @@
+/*!
+* \brief . 
+*/
+
+#include "ecas/ecas.hpp"
+
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <atomic>
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+// n1 -> n2 -> n4
+//    -> n3 ->
+void AddOne(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    float *in = (float *)inputs[0]->GetData();
+    int len = inputs[0]->shape()[0];
+    for (int oi = 0; oi < outputs.size(); oi++) {
+        float *out = (float *)outputs[oi]->GetData();
+        for (int i = 0; i < len; i++)
+            out[i] = in[i] + 1;
+    }
+}
+
+void MulTwo(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    float *in = (float *)inputs[0]->GetData();
+    float *out = (float *)outputs[0]->GetData();
+    for (int i = 0; i < inputs[0]->shape()[0]; i++)
+        out[i] = in[i] * 2;
+}
+
+void Sum(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    float *out = (float *)outputs[0]->GetData();
+    out[0] = 0;
+    for (int ii = 0; ii < inputs.size(); ii++) {
+        float *in = (float *)inputs[ii]->GetData();
+        for (int i = 0; i < inputs[ii]->shape()[0]; i++)
+            out[0] += in[i];
+    }
+}
+
+void DiamondGraphTest(SessionConfig &config, int num_frame = 30,
+                      std::vector<std::vector<std::string>> relation = {{"n1", "n2", "n4"}, {"n1", "n3", "n4"}},
+                      bool is_broadcast = false, std::function<void(Session *)> check = nullptr) {
+    int len = 16;
+    Session *session = new Session("diamond", config);
+    if (is_broadcast)
+        session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    else
+        session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}, {FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("n4", Sum, {{FP32, len}, {FP32, len}}, {{FP32, 1}}, 0);
+    session->BuildGraph(std::move(relation));
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({1}, FP32);
+    session->Start(nullptr);
+
+    std::set<int> ids;
+    float *in_data = (float *)in->GetData();
+    for (int i = 0; i < num_frame; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        // Keep the queues from being filled up.
+        if (i >= 5) {
+            session->GraphGetResult(out);
+            int id = out->id();
+            EXPECT_EQ(((float *)out->GetData())[0], ((id + 1) * 2 + (id + 2)) * len);
+            ids.insert(id);
+        }
+    }
+    for (int i = 0; i < 5; i++) {
+        session->GraphGetResult(out);
+        int id = out->id();
+        EXPECT_EQ(((float *)out->GetData())[0], ((id + 1) * 2 + (id + 2)) * len);
+        ids.insert(id);
+    }
+    EXPECT_EQ(ids.size(), num_frame);
+    if (check)
+        check(session);
+
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, GroupThread) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 1;
+    config.policy = GROUP_THREAD;
+    DiamondGraphTest(config);
+}
+
+TEST(CoreTest, WorkStealing) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 4;
+    config.policy = WORK_STEALING;
+    DiamondGraphTest(config);
+}
+
+TEST(CoreTest, GroupAttr) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 1;
+    config.policy = GROUP_THREAD;
+    // Binding fails quietly if core 0 is not available.
+    GroupAttr attr;
+    attr.group_id = 1;
+    attr.cpus = {0};
+    config.group_attrs.push_back(attr);
+    DiamondGraphTest(config);
+}
+
+TEST(CoreTest, Profiler) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    config.policy = WORK_STEALING;
+    config.profile_path = "ecas_profiler_test.json";
+    DiamondGraphTest(config);
+
+    std::ifstream file(config.profile_path);
+    ASSERT_TRUE(file.is_open());
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::string trace = ss.str();
+    EXPECT_NE(trace.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"run\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"n4\""), std::string::npos);
+    EXPECT_EQ(trace.substr(trace.size() - 3), "]}\n");
+    file.close();
+    remove(config.profile_path.c_str());
+}
+
+TEST(CoreTest, EdgeDepth) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    config.policy = WORK_STEALING;
+    // Frames in flight are limited to 5 by the test, so that depth 2 is enough.
+    DiamondGraphTest(config, 600, {{"input[depth=2]", "n1", "n2[depth=auto]", "n4", "output[depth=3]"},
+                                   {"n1", "n3[depth=2]", "n4[depth=auto]"}}, false, [](Session *session) {
+        EXPECT_EQ(session->GraphGetEdgeDepth("input", "n1"), 2);
+        EXPECT_EQ(session->GraphGetEdgeDepth("n1", "n3"), 2);
+        EXPECT_EQ(session->GraphGetEdgeDepth("n4", "output"), 3);
+        EXPECT_EQ(session->GraphGetEdgeDepth("n2", "n4"), 10);
+        // Shrunk from the default 10, few of the slots are used with the frames in flight limited.
+        int depth = session->GraphGetEdgeDepth("n1", "n2");
+        EXPECT_GE(depth, 1);
+        EXPECT_LT(depth, 10);
+        depth = session->GraphGetEdgeDepth("n3", "n4");
+        EXPECT_GE(depth, 1);
+        EXPECT_LT(depth, 10);
+    });
+}
+
+TEST(CoreTest, Broadcast) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 4;
+    config.policy = WORK_STEALING;
+    DiamondGraphTest(config, 200, {{"n1", "n2", "n4"}, {"n1", "n3", "n4"}}, true);
+}
+
+// The replicas of n2 finish out of order, but the results keep the input order.
+void SlowMulTwo(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    std::this_thread::sleep_for(std::chrono::microseconds((inputs[0]->id() % 3) * 200));
+    MulTwo(usr, inputs, outputs);
+}
+
+TEST(CoreTest, Replica) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 4;
+    config.policy = WORK_STEALING;
+    int len = 16;
+    int num_frame = 100;
+    Session *session = new Session("replica", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", SlowMulTwo, {{FP32, len}}, {{FP32, len}}, 0, 3);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->BuildGraph({{"n1", "n2", "n3"}});
+    session->Start(nullptr);
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    float *in_data = (float *)in->GetData();
+    int num_fed = 0;
+    for (int i = 0; i < num_frame; i++) {
+        // Keep several frames in flight.
+        for (; num_fed < num_frame && num_fed < i + 6; num_fed++) {
+            for (int j = 0; j < len; j++)
+                in_data[j] = num_fed;
+            in->SetId(num_fed);
+            session->GraphFeed(in);
+        }
+        session->GraphGetResult(out);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[0], (i + 1) * 2 + 1);
+    }
+    session->Stop();
+    delete session;
+}
+
+// Sums up the inputs of each stream.
+void StreamSum(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    float *sum = (float *)TaskContext::State();
+    float *in = (float *)inputs[0]->GetData();
+    float *out = (float *)outputs[0]->GetData();
+    EXPECT_EQ(TaskContext::StreamId(), inputs[0]->stream_id());
+    for (int i = 0; i < inputs[0]->shape()[0]; i++) {
+        sum[i] += in[i];
+        out[i] = sum[i];
+    }
+}
+
+TEST(CoreTest, Calibrate) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    config.policy = GROUP_THREAD;
+    int len = 16;
+    Session *session = new Session("calibrate", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", SlowMulTwo, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->BuildGraph({{"n1", "n2", "n3"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    float *in_data = (float *)in->GetData();
+    for (int j = 0; j < len; j++)
+        in_data[j] = 0;
+    in->SetId(1);
+    session->GraphCalibrate(nullptr, in, 3);
+    session->Start(nullptr);
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[0], (i + 1) * 2 + 1);
+    }
+    session->Stop();
+    delete session;
+
+    // The calibration leaves no state or memory behind, even if it is repeated.
+    session = new Session("calibrate_state", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", StreamSum, {{FP32, len}}, {{FP32, len}}, 0);
+    session->DeclareNodeState("n2", len * sizeof(float));
+    session->BuildGraph({{"n1", "n2"}});
+    in = session->CreateITensor({len}, FP32);
+    out = session->CreateITensor({len}, FP32);
+    in_data = (float *)in->GetData();
+    for (int j = 0; j < len; j++)
+        in_data[j] = 1;
+    session->GraphCalibrate(nullptr, in, 3);
+    uint64_t bytes_in_use = session->GetMemoryStats().bytes_in_use;
+    session->GraphCalibrate(nullptr, in, 3);
+    EXPECT_EQ(session->GetMemoryStats().bytes_in_use, bytes_in_use);
+    session->Start(nullptr);
+    float sum = 0;
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        sum += i + 1;
+        EXPECT_EQ(((float *)out->GetData())[0], sum);
+    }
+    session->Stop();
+    delete session;
+}
+
+// The frames are fed faster than they are consumed, the dropped ones never come out.
+void SlowAddOne(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    AddOne(usr, inputs, outputs);
+}
+
+void SlowSum(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    Sum(usr, inputs, outputs);
+}
+
+// The join n4 of the diamond graph matches the frames left by the dropping edge.
+void OverflowTest(std::vector<std::vector<std::string>> relation, const std::string &front,
+                  const std::string &rear, bool is_join = false) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    config.policy = WORK_STEALING;
+    int len = 16;
+    int num_frame = 50;
+    Session *session = new Session("overflow", config);
+    if (is_join) {
+        session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}, {FP32, len}}, 0);
+        session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 0);
+        session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+        session->CreateNode("n4", SlowSum, {{FP32, len}, {FP32, len}}, {{FP32, 1}}, 0);
+    }
+    else {
+        session->CreateNode("n1", SlowMulTwo, {{FP32, len}}, {{FP32, len}}, 0);
+        session->CreateNode("n2", SlowAddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    }
+    session->BuildGraph(std::move(relation));
+    session->Start(nullptr);
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({is_join ? 1 : len}, FP32);
+    float *in_data = (float *)in->GetData();
+    for (int i = 0; i < num_frame; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+    }
+    // Wait for the dropping edge to be drained.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int64_t num_dropped = session->GraphGetDroppedFrames(front, rear);
+    EXPECT_GT(num_dropped, 0);
+    int last_id = -1;
+    for (int i = 0; i < num_frame - num_dropped; i++) {
+        session->GraphGetResult(out);
+        EXPECT_GT(out->id(), last_id);
+        if (is_join) {
+            EXPECT_EQ(((float *)out->GetData())[0], ((out->id() + 1) * 2 + (out->id() + 2)) * len);
+        }
+        else {
+            EXPECT_EQ(((float *)out->GetData())[0], out->id() * 2 + 1);
+        }
+        last_id = out->id();
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, Overflow) {
+    OverflowTest({{"input[depth=2,overflow=drop_oldest]", "n1", "n2", "output[depth=64]"}}, "input", "n1");
+    OverflowTest({{"input[depth=2,overflow=drop_newest]", "n1", "n2", "output[depth=64]"}}, "input", "n1");
+    OverflowTest({{"input[depth=2,overflow=latest]", "n1", "n2", "output[depth=64]"}}, "input", "n1");
+    OverflowTest({{"input[depth=64]", "n1", "n2[depth=2,overflow=drop_oldest]", "output[depth=64]"}}, "n1", "n2");
+    OverflowTest({{"input[depth=64]", "n1", "n2[depth=2,overflow=drop_newest]", "output[depth=64]"}}, "n1", "n2");
+    OverflowTest({{"input[depth=64]", "n1", "n2[depth=2,overflow=latest]", "output[depth=64]"}}, "n1", "n2");
+    // The partners of the dropped frames are dropped by the join on n2 -> n4.
+    OverflowTest({{"input[depth=64]", "n1", "n2[depth=64]", "n4[depth=64]", "output[depth=64]"},
+                  {"n1", "n3[depth=64]", "n4[depth=2,overflow=drop_oldest]"}}, "n3", "n4", true);
+    OverflowTest({{"input[depth=64]", "n1", "n2[depth=64]", "n4[depth=64]", "output[depth=64]"},
+                  {"n1", "n3[depth=64]", "n4[depth=2,overflow=latest]"}}, "n3", "n4", true);
+}
+
+void ZeroCopyTest(SessionConfig &config) {
+    int len = 16;
+    int num_frame = 30;
+    Session *session = new Session("zero_copy", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->BuildGraph({{"n1", "n2"}});
+    session->Start(nullptr);
+
+    for (int i = 0; i < num_frame; i++) {
+        ITensor *in = session->GraphBorrowInput();
+        ASSERT_NE(in, nullptr);
+        float *in_data = (float *)in->GetData();
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphSubmitInput(in);
+
+        ITensor *out = session->GraphTakeResult();
+        ASSERT_NE(out, nullptr);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[len - 1], (i + 1) * 2);
+        session->GraphReleaseResult(out);
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, ZeroCopy) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 1;
+    ZeroCopyTest(config);
+    config.mode = SERIAL;
+    ZeroCopyTest(config);
+}
+
+void FeedAsyncTest(SessionConfig &config) {
+    int len = 16;
+    int num_frame = 20;
+    Session *session = new Session("feed_async", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->BuildGraph({{"n1", "n2"}});
+    session->Start(nullptr);
+
+    // Two request threads share the graph without a collector thread.
+    auto request = [&](int begin, int end) -> void {
+        ITensor *in = session->CreateITensor({len}, FP32);
+        std::vector<ITensor *> outs;
+        std::vector<std::future<void>> futures;
+        for (int i = begin; i < end; i++) {
+            float *in_data = (float *)in->GetData();
+            for (int j = 0; j < len; j++)
+                in_data[j] = i;
+            in->SetId(i);
+            outs.push_back(session->CreateITensor({len}, FP32));
+            futures.push_back(session->GraphFeedAsync(in, outs.back()));
+        }
+        for (int i = 0; i < futures.size(); i++) {
+            futures[i].wait();
+            EXPECT_EQ(outs[i]->id(), begin + i);
+            EXPECT_EQ(((float *)outs[i]->GetData())[0], (begin + i + 1) * 2);
+        }
+    };
+    std::thread t0(request, 0, num_frame);
+    std::thread t1(request, num_frame, num_frame * 2);
+    t0.join();
+    t1.join();
+
+    // Callback version, the result is only valid inside it.
+    ITensor *in = session->CreateITensor({len}, FP32);
+    std::promise<float> result;
+    in->SetId(100);
+    ((float *)in->GetData())[0] = 1;
+    session->GraphFeedAsync(in, [&result](ITensor *out) -> void {
+        result.set_value(((float *)out->GetData())[0]);
+    });
+    EXPECT_EQ(result.get_future().get(), 4);
+
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, FeedAsync) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 1;
+    FeedAsyncTest(config);
+    config.mode = SERIAL;
+    FeedAsyncTest(config);
+}
+
+void CompositeTest(SessionConfig &config) {
+    int len = 16;
+    Session *session = new Session("composite", config);
+    // The diamond runs in one composite node, followed by a normal node.
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n4", Sum, {{FP32, len}, {FP32, len}}, {{FP32, 1}}, 0);
+    session->CreateNode("c", {{"n1", "n2", "n4"}, {"n1", "n3", "n4"}}, 0);
+    session->CreateNode("n5", MulTwo, {{FP32, 1}}, {{FP32, 1}}, 1);
+    session->BuildGraph({{"c", "n5"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({1}, FP32);
+    session->Start(nullptr);
+    float *in_data = (float *)in->GetData();
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[0], ((i + 1) * 2 + (i + 2)) * len * 2);
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, Composite) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    CompositeTest(config);
+    config.mode = SERIAL;
+    CompositeTest(config);
+}
+
+void FuseChainsTest(SessionConfig &config) {
+    int len = 16;
+    Session *session = new Session("fuse_chains", config);
+    // n1 -> n2 can be fused, n2 -> n3 keeps its queue for the depth, n4 is in another group.
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n4", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->BuildGraph({{"input[depth=2]", "n1", "n2", "n3[depth=4]", "n4"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    session->Start(nullptr);
+    float *in_data = (float *)in->GetData();
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[len - 1], ((i + 1) * 2 + 1) * 2);
+    }
+    // The edges are found by the original names after fusion.
+    EXPECT_EQ(session->GraphGetEdgeDepth("input", "n1"), 2);
+    EXPECT_EQ(session->GraphGetEdgeDepth("n2", "n3"), 4);
+    EXPECT_EQ(session->GraphGetDroppedFrames("n3", "n4"), 0);
+    session->Stop();
+    delete session;
+}
+
+std::string ReadTrace(const std::string &path) {
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    file.close();
+    remove(path.c_str());
+    return ss.str();
+}
+
+// The chain is fused only if fuse_chains is set with GROUP_THREAD.
+TEST(CoreTest, FuseChains) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    config.profile_path = "ecas_fuse_test.json";
+    config.fuse_chains = true;
+    FuseChainsTest(config);
+    std::string trace = ReadTrace(config.profile_path);
+    EXPECT_NE(trace.find("\"n1+n2 -> n3\""), std::string::npos);
+    EXPECT_EQ(trace.find("\"n1 -> n2\""), std::string::npos);
+
+    config.policy = WORK_STEALING;
+    FuseChainsTest(config);
+    trace = ReadTrace(config.profile_path);
+    EXPECT_NE(trace.find("\"n1 -> n2\""), std::string::npos);
+    EXPECT_EQ(trace.find("n1+n2"), std::string::npos);
+
+    config.policy = GROUP_THREAD;
+    config.fuse_chains = false;
+    FuseChainsTest(config);
+    trace = ReadTrace(config.profile_path);
+    EXPECT_NE(trace.find("\"n1 -> n2\""), std::string::npos);
+    EXPECT_EQ(trace.find("n1+n2"), std::string::npos);
+}
+
+// y = x + s, and y is also the state s of the next frame.
+void Accumulate(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    float *x = (float *)inputs[0]->GetData();
+    float *s = (float *)inputs[1]->GetData();
+    float *y = (float *)outputs[0]->GetData();
+    float *next = (float *)outputs[1]->GetData();
+    for (int i = 0; i < inputs[0]->shape()[0]; i++) {
+        y[i] = x[i] + s[i];
+        next[i] = y[i];
+    }
+}
+
+void DelayTest(SessionConfig &config) {
+    int len = 16;
+    Session *session = new Session("delay", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("acc", Accumulate, {{FP32, len}, {FP32, len}}, {{FP32, len}, {FP32, len}}, 1);
+    session->CreateNode("n3", MulTwo, {{FP32, len}}, {{FP32, len}}, 0);
+    // The state starts from 10 and circulates through acc.
+    session->BuildGraph({{"n1", "acc", "n3"}, {"acc", "acc[delay=10]"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    session->Start(nullptr);
+    float *in_data = (float *)in->GetData();
+    float state = 10;
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        state += i + 1;
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[len - 1], state * 2);
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, Delay) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    DelayTest(config);
+    config.mode = SERIAL;
+    DelayTest(config);
+}
+
+void MultiStreamTest(SessionConfig &config) {
+    int len = 16;
+    int num_stream = 3;
+    Session *session = new Session("multi_stream", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", StreamSum, {{FP32, len}}, {{FP32, len}}, 1);
+    session->DeclareNodeState("n2", len * sizeof(float));
+    session->BuildGraph({{"n1", "n2"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    session->Start(nullptr);
+    float *in_data = (float *)in->GetData();
+    std::vector<float> sums(num_stream, 0);
+    for (int i = 0; i < 5; i++) {
+        for (int s = 0; s < num_stream; s++) {
+            for (int j = 0; j < len; j++)
+                in_data[j] = i * 10 + s;
+            in->SetId(i * num_stream + s);
+            session->GraphFeed(in, s);
+            sums[s] += i * 10 + s + 1;
+        }
+        // Taken in the reverse order.
+        for (int s = num_stream - 1; s >= 0; s--) {
+            session->GraphGetResult(out, s);
+            EXPECT_EQ(out->stream_id(), s);
+            EXPECT_EQ(out->id(), i * num_stream + s);
+            EXPECT_EQ(((float *)out->GetData())[len - 1], sums[s]);
+        }
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, MultiStream) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    MultiStreamTest(config);
+    config.mode = SERIAL;
+    MultiStreamTest(config);
+}
+
+void GraphPortsTest(SessionConfig &config) {
+    int len = 16;
+    Session *session = new Session("graph_ports", config);
+    session->CreateNode("v1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("a1", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("a2", AddOne, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("fuse", Sum, {{FP32, len}, {FP32, len}}, {{FP32, 1}}, 0);
+    // The output of a2 is left unnamed, as "output:a2".
+    session->BuildGraph({{"input:video", "v1", "fuse", "output:score"}, {"input:audio", "a1", "fuse"}, {"a1", "a2"}});
+
+    ITensor *video = session->CreateITensor({len}, FP32);
+    ITensor *audio = session->CreateITensor({len}, FP32);
+    ITensor *score = session->CreateITensor({1}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    session->Start(nullptr);
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < len; j++) {
+            ((float *)video->GetData())[j] = i;
+            ((float *)audio->GetData())[j] = i * 10;
+        }
+        video->SetId(i);
+        audio->SetId(i);
+        session->GraphFeed("video", video);
+        // The video frame 2 has no audio, it is dropped by the join.
+        if (i == 2)
+            continue;
+        session->GraphFeed("audio", audio);
+        session->GraphGetResult("score", score);
+        EXPECT_EQ(score->id(), i);
+        EXPECT_EQ(((float *)score->GetData())[0], ((i + 1) + i * 20) * len);
+        session->GraphGetResult("output:a2", out);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[0], i * 20 + 1);
+    }
+    if (config.mode != SERIAL) {
+        EXPECT_EQ(session->GraphGetDroppedFrames("v1", "fuse"), 1);
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, GraphPorts) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    GraphPortsTest(config);
+    config.mode = SERIAL;
+    GraphPortsTest(config);
+}
+
+// Reverses the input through a scratch buffer.
+void Reverse(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    int len = inputs[0]->shape()[0];
+    float *in = (float *)inputs[0]->GetData();
+    float *out = (float *)outputs[0]->GetData();
+    float *temp = (float *)TaskContext::ScratchAlloc(len * sizeof(float));
+    EXPECT_EQ((uintptr_t)temp % 64, 0);
+    for (int i = 0; i < len; i++)
+        temp[len - 1 - i] = in[i];
+    for (int i = 0; i < len; i++)
+        out[i] = temp[i];
+}
+
+void ScratchTest(SessionConfig &config) {
+    int len = 16;
+    Session *session = new Session("scratch", config);
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", Reverse, {{FP32, len}}, {{FP32, len}}, 1);
+    session->BuildGraph({{"n1", "n2"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({len}, FP32);
+    session->Start(nullptr);
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            ((float *)in->GetData())[j] = i * 100 + j;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        EXPECT_EQ(((float *)out->GetData())[0], i * 100 + len);
+    }
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, Scratch) {
+    EXPECT_EQ(TaskContext::ScratchAlloc(16), nullptr);
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    ScratchTest(config);
+    config.mode = SERIAL;
+    ScratchTest(config);
+}
+
+std::atomic<bool> is_gate_open(false);
+
+void Gate(void *usr, std::vector<ITensor *> &inputs, std::vector<ITensor *> &outputs) {
+    while (!is_gate_open)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    AddOne(usr, inputs, outputs);
+}
+
+TEST(CoreTest, Priority) {
+    SessionConfig config;
+    config.mode = GRAPH;
+    config.num_thread = 2;
+    int len = 16;
+    Session *session = new Session("priority", config);
+    session->CreateNode("n1", Gate, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("n4", Sum, {{FP32, len}, {FP32, len}}, {{FP32, 1}}, 0);
+    session->BuildGraph({{"n1", "n2", "n4"}, {"n1", "n3", "n4"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({1}, FP32);
+    is_gate_open = false;
+    session->Start(nullptr);
+    // The normal frames wait in the queue of n1, then the urgent one goes ahead of them.
+    int urgent_id = 100;
+    for (int i = 0; i <= 5; i++) {
+        int id = i < 5 ? i : urgent_id;
+        for (int j = 0; j < len; j++)
+            ((float *)in->GetData())[j] = id;
+        in->SetId(id);
+        session->GraphFeed(in, -1, i < 5 ? 0 : 1);
+    }
+    // The priority goes with the frame only, not with the tensor fed.
+    EXPECT_EQ(in->priority(), 0);
+    is_gate_open = true;
+    int last_id = -1;
+    for (int i = 0; i <= 5; i++) {
+        session->GraphGetResult(out);
+        // The frames of the join are matched in both lanes.
+        EXPECT_EQ(((float *)out->GetData())[0], ((out->id() + 1) * 2 + (out->id() + 2)) * len);
+        if (out->id() == urgent_id) {
+            EXPECT_LE(i, 1);
+            EXPECT_EQ(out->priority(), 1);
+            continue;
+        }
+        EXPECT_GT(out->id(), last_id);
+        last_id = out->id();
+    }
+    EXPECT_EQ(last_id, 4);
+    session->Stop();
+    delete session;
+}
+
+TEST(CoreTest, Serial) {
+    SessionConfig config;
+    config.mode = SERIAL;
+    config.num_thread = 1;
+    int len = 16;
+    Session *session = new Session("serial", config);
+    // Broadcast output of n1.
+    session->CreateNode("n1", AddOne, {{FP32, len}}, {{FP32, len}}, 0);
+    session->CreateNode("n2", MulTwo, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("n3", AddOne, {{FP32, len}}, {{FP32, len}}, 1);
+    session->CreateNode("n4", Sum, {{FP32, len}, {FP32, len}}, {{FP32, 1}}, 0);
+    // Declared in reverse order.
+    session->BuildGraph({{"n3", "n4"}, {"n2", "n4"}, {"n1", "n3"}, {"n1", "n2"}});
+
+    ITensor *in = session->CreateITensor({len}, FP32);
+    ITensor *out = session->CreateITensor({1}, FP32);
+    session->Start(nullptr);
+    float *in_data = (float *)in->GetData();
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < len; j++)
+            in_data[j] = i;
+        in->SetId(i);
+        session->GraphFeed(in);
+        session->GraphGetResult(out);
+        EXPECT_EQ(out->id(), i);
+        EXPECT_EQ(((float *)out->GetData())[0], ((i + 1) * 2 + (i + 2)) * len);
+    }
+    session->Stop();
+    delete session;
+}
+
+}  // end of namespace.
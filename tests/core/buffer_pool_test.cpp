@@ -0,0 +1,59 @@
+/*!
+* \brief . 
+*/
+
+#include "core/buffer_pool.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+TEST(CoreTest, BufferPool) {
+    EXPECT_EQ(BufferPool::ClassSize(1), 64);
+    EXPECT_EQ(BufferPool::ClassSize(64), 64);
+    EXPECT_EQ(BufferPool::ClassSize(65), 80);
+    EXPECT_EQ(BufferPool::ClassSize(128), 128);
+    EXPECT_EQ(BufferPool::ClassSize(1000), 1024);
+    EXPECT_EQ(BufferPool::ClassSize(1025), 1280);
+
+    BufferPool pool;
+    Buffer *a = pool.Acquire(1000);
+    Buffer *b = pool.Acquire(4000);
+    EXPECT_EQ(a->size(), 1024);
+    ((char *)a->data())[0] = 1;
+    pool.Release(a);
+    EXPECT_EQ(pool.stats().bytes_cached, 1024);
+    // A compatible size gets it back, zeroed.
+    Buffer *c = pool.Acquire(900);
+    EXPECT_EQ(c, a);
+    EXPECT_EQ(((char *)c->data())[0], 0);
+    MemoryStats stats = pool.stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.bytes_in_use, 1024 + 4096);
+
+    pool.Release(b);
+    pool.Release(c);
+    pool.Trim(2048);
+    EXPECT_EQ(pool.stats().bytes_cached, 1024);
+    pool.Trim();
+    EXPECT_EQ(pool.stats().bytes_cached, 0);
+
+    // The tensors of the session.
+    SessionConfig config;
+    config.mode = SERIAL;
+    config.num_thread = 1;
+    Session *session = new Session("buffer_pool", config);
+    ITensor *t = session->CreateITensor({256}, FP32);
+    session->ReleaseITensor(t);
+    t = session->CreateITensor({250}, FP32);
+    EXPECT_EQ(session->GetMemoryStats().hits, 1);
+    session->ReleaseITensor(t);
+    session->TrimMemory();
+    EXPECT_EQ(session->GetMemoryStats().bytes_cached, 0);
+    delete session;
+}
+
+}  // end of namespace.
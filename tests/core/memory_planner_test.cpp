@@ -0,0 +1,37 @@
+/*!
+* \brief . 
+*/
+
+#include "core/memory_planner.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+void MemoryPlannerTest() {
+    // A chain: a(0->1), b(1->2), c(2->3), d(3->4), e(0->4)
+    MemoryPlanner planner(64);
+    int a = planner.AddBlock(1000, 0, 1);
+    int b = planner.AddBlock(2000, 1, 2);
+    int c = planner.AddBlock(1000, 2, 3);
+    int d = planner.AddBlock(500, 3, 4);
+    int e = planner.AddBlock(64, 0, 4);
+    planner.Plan();
+
+    EXPECT_EQ(planner.naive_size(), 1024 + 2048 + 1024 + 512 + 64);
+    // b is the largest, a / c live together with b and can not share with it.
+    EXPECT_EQ(planner.offset(b), 0);
+    EXPECT_EQ(planner.offset(a), 2048);
+    EXPECT_EQ(planner.offset(c), 2048);
+    EXPECT_EQ(planner.offset(d), 0);
+    EXPECT_EQ(planner.offset(e), 2048 + 1024);
+    EXPECT_EQ(planner.planned_size(), 2048 + 1024 + 64);
+}
+
+TEST(CoreTest, MemoryPlanner) {
+    MemoryPlannerTest();
+}
+
+}  // end of namespace.
@@ -0,0 +1,34 @@
+/*!
+* \brief . 
+*/
+
+#include "core/scheduler.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+void PartitionCostsTest() {
+    std::vector<double> costs = {100, 300, 100, 100};
+    std::vector<int> firsts = Scheduler::PartitionCosts(costs, 2);
+    ASSERT_EQ(firsts.size(), 2);
+    EXPECT_EQ(firsts[0], 0);
+    EXPECT_EQ(firsts[1], 2); // {100, 300} | {100, 100}
+
+    firsts = Scheduler::PartitionCosts(costs, 3);
+    ASSERT_EQ(firsts.size(), 3);
+    EXPECT_EQ(firsts[1], 1);
+    EXPECT_EQ(firsts[2], 2); // {100} | {300} | {100, 100}
+
+    firsts = Scheduler::PartitionCosts(costs, 4);
+    for (int i = 0; i < 4; i++)
+        EXPECT_EQ(firsts[i], i);
+}
+
+TEST(CoreTest, PartitionCosts) {
+    PartitionCostsTest();
+}
+
+}  // end of namespace.
@@ -0,0 +1,77 @@
+/*!
+* \brief . 
+*/
+
+#include "ecas/ecas.hpp"
+#include "core/tensor.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas;
+
+TEST(CoreTest, TensorView) {
+    SessionConfig config;
+    config.mode = SERIAL;
+    Session *session = new Session("view", config);
+
+    // 2 x 3 x 2 x 4, NCHW.
+    ITensor *t = session->CreateITensor({2, 3, 2, 4}, FP32);
+    float *data = (float *)t->GetData();
+    for (int i = 0; i < 48; i++)
+        data[i] = i;
+    EXPECT_TRUE(t->is_contiguous());
+
+    // The channel 1 shares the memory, and is copied out by CopyTo.
+    ITensor *c1 = session->SliceITensor(t, 1, 1, 2);
+    EXPECT_FALSE(c1->is_contiguous());
+    EXPECT_EQ(c1->GetData(), data + 8);
+    ITensor *out = session->CreateITensor({2, 1, 2, 4}, FP32);
+    ((Tensor *)c1)->CopyTo(out);
+    EXPECT_EQ(((float *)out->GetData())[0], 8);
+    EXPECT_EQ(((float *)out->GetData())[8], 32);
+
+    // Columns 1 and 2 of the last axis, filled without touching the others.
+    ITensor *cols = session->SliceITensor(t, 3, 1, 3);
+    EXPECT_EQ(cols->strides()[2], 4);
+    ((Tensor *)cols)->Fill(-1);
+    EXPECT_EQ(data[0], 0);
+    EXPECT_EQ(data[1], -1);
+    EXPECT_EQ(data[2], -1);
+    EXPECT_EQ(data[3], 3);
+    EXPECT_EQ(data[45], -1);
+    EXPECT_EQ(data[47], 47);
+
+    // Reshape of a contiguous tensor, and a slice of a view.
+    ITensor *mat = session->CreateViewITensor(t, {6, 8});
+    EXPECT_EQ(mat->GetData(), data);
+    ITensor *rows = session->SliceITensor(mat, 0, 2, 4);
+    ITensor *sub = session->SliceITensor(rows, 1, 4, 8);
+    EXPECT_EQ(sub->GetData(), data + 20);
+    EXPECT_EQ(sub->strides()[0], 8);
+    session->ReleaseITensor(sub);
+    EXPECT_EQ(data[20], 20);
+
+    // Gemm on the views, with the leading dimensions from their strides.
+    // A: the left 2 x 3 of a 2 x 8, B: the middle 3 x 2 of a 3 x 6, C: the right 2 x 2 of a 2 x 5.
+    void *op = session->CreateOp("gemm", "alpha: 1.0, beta: 0.0,");
+    ITensor *a = session->CreateITensor({2, 8}, FP32);
+    ITensor *b = session->CreateITensor({3, 6}, FP32);
+    ITensor *c = session->CreateITensor({2, 5}, FP32);
+    ((Tensor *)a)->Fill(1);
+    ((Tensor *)b)->Fill(2);
+    ((Tensor *)c)->Fill(7);
+    std::vector<ITensor *> inputs = {session->SliceITensor(a, 1, 0, 3), session->SliceITensor(b, 1, 2, 4)};
+    std::vector<ITensor *> outputs = {session->SliceITensor(c, 1, 3, 5)};
+    std::vector<Param> params;
+    session->OpRun(op, params, inputs, outputs);
+    float *c_data = (float *)c->GetData();
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 5; j++)
+            EXPECT_EQ(c_data[i * 5 + j], j < 3 ? 7 : 6);
+    }
+    delete session;
+}
+
+}  // end of namespace.
@@ -0,0 +1,42 @@
+/*!
+* \brief .
+*/
+
+#include "util/scratch_arena.hpp"
+
+#include <stdint.h>
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas::util;
+
+TEST(UtilTest, ScratchArena) {
+    ScratchArena arena;
+    ScratchArena::Mark start = arena.GetMark();
+    char *a = (char *)arena.Alloc(10);
+    char *b = (char *)arena.Alloc(100);
+    EXPECT_EQ((uintptr_t)a % ECAS_SCRATCH_ALIGNMENT, 0);
+    EXPECT_EQ(b - a, ECAS_SCRATCH_ALIGNMENT);
+
+    // Back to the mark, the same memory is handed out again.
+    ScratchArena::Mark mark = arena.GetMark();
+    char *c = (char *)arena.Alloc(32);
+    arena.Reset(mark);
+    EXPECT_EQ(arena.Alloc(32), c);
+
+    // Beyond the first chunk, the chunks are merged at the reset to the start.
+    arena.Alloc(ECAS_SCRATCH_MIN_CHUNK);
+    EXPECT_GT(arena.capacity(), ECAS_SCRATCH_MIN_CHUNK);
+    arena.Reset(start);
+    uint64_t capacity = arena.capacity();
+    for (int i = 0; i < 3; i++) {
+        arena.Alloc(10);
+        arena.Alloc(100);
+        arena.Alloc(ECAS_SCRATCH_MIN_CHUNK);
+        arena.Reset(start);
+        EXPECT_EQ(arena.capacity(), capacity);
+    }
+}
+
+}  // end of namespace.
@@ -0,0 +1,97 @@
+/*!
+* \brief .
+*/
+
+#include "util/spsc_queue.hpp"
+#include "util/blocking_queue.hpp"
+
+#include <stdio.h>
+#include <thread>
+#include <chrono>
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace ecas::util;
+
+TEST(UtilTest, SpscQueue) {
+    int num = 100000;
+    SpscQueue<int> queue(8);
+    std::thread producer([&]() {
+        for (int i = 0; i < num; i++)
+            queue.push(i);
+    });
+    int value;
+    for (int i = 0; i < num; i++) {
+        EXPECT_TRUE(queue.wait_and_pop(&value));
+        EXPECT_EQ(value, i);
+    }
+    producer.join();
+    EXPECT_TRUE(queue.empty());
+
+    // Two producers, the order of each one is kept.
+    queue.SetMultiProducer(true);
+    std::thread p0([&]() { for (int i = 0; i < num; i++) queue.push(i * 2); });
+    std::thread p1([&]() { for (int i = 0; i < num; i++) queue.push(i * 2 + 1); });
+    int last[2] = {-1, -1};
+    for (int i = 0; i < num * 2; i++) {
+        EXPECT_TRUE(queue.wait_and_pop(&value));
+        EXPECT_GT(value, last[value % 2]);
+        last[value % 2] = value;
+    }
+    p0.join();
+    p1.join();
+
+    // The urgent lane is popped first, unless the normal one is asked for.
+    queue.SetMultiProducer(false);
+    queue.push(1);
+    queue.push(2);
+    queue.push(3, true);
+    EXPECT_EQ(queue.size(true), 1);
+    EXPECT_TRUE(queue.try_front(&value));
+    EXPECT_EQ(value, 3);
+    EXPECT_TRUE(queue.try_pop(&value, false));
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(queue.wait_and_pop(&value));
+    EXPECT_EQ(value, 3);
+    EXPECT_TRUE(queue.wait_and_pop(&value));
+    EXPECT_EQ(value, 2);
+
+    // Exit wakes up the waiting consumer.
+    std::thread waiter([&]() { EXPECT_FALSE(queue.wait_and_pop(&value)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.exit();
+    waiter.join();
+}
+
+// Ping-pong between two threads, each round trip has two hops.
+template <typename Queue>
+double PingPongNs(Queue &ping, Queue &pong, int rounds) {
+    std::thread echo([&]() {
+        int v;
+        for (int i = 0; i < rounds; i++) {
+            ping.wait_and_pop(&v);
+            pong.push(v);
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    int v;
+    for (int i = 0; i < rounds; i++) {
+        ping.push(i);
+        pong.wait_and_pop(&v);
+    }
+    auto end = std::chrono::steady_clock::now();
+    echo.join();
+    return std::chrono::duration<double, std::nano>(end - start).count() / rounds / 2;
+}
+
+TEST(UtilTest, SpscQueueLatency) {
+    int rounds = 20000;
+    BlockingQueue<int> bq_ping, bq_pong;
+    SpscQueue<int> sq_ping(16), sq_pong(16);
+    double bq_ns = PingPongNs(bq_ping, bq_pong, rounds);
+    double sq_ns = PingPongNs(sq_ping, sq_pong, rounds);
+    printf("Per-hop latency: BlockingQueue %.1f ns, SpscQueue %.1f ns.\n", bq_ns, sq_ns);
+}
+
+}  // end of namespace.